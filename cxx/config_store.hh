@@ -0,0 +1,259 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef ZBB_CONFIG_CONFIG_STORE_HH
+#define ZBB_CONFIG_CONFIG_STORE_HH
+
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include "./json_file.hpp"
+#include "./properties.hh"
+#include "./ns.hh"
+
+#if defined(__linux__)
+#   include <poll.h>
+#   include <unistd.h>
+#   include <sys/eventfd.h>
+#   include <sys/inotify.h>
+#endif
+
+
+//
+// - A config file parsed once per change, read from any thread
+//    - Every successful parse publishes a new immutable snapshot; a failed
+//      one keeps the previous snapshot.
+//    - current() hands out the snapshot as a shared_ptr to const, the
+//      atomic shared_ptr swap keeps it alive for as long as it is held.
+//    - A reader caches the snapshot and compares one atomic version per
+//      get(), so the steady state is a single load: no lock, no copy and
+//      no reference count traffic; a changed version refreshes the cache.
+//    - watch() reloads on change: inotify on the directory on Linux (the
+//      file itself is usually replaced by a rename, see json_file), the
+//      file's write time polled elsewhere.
+//
+ZBB_CONFIG_BEGIN
+
+template<typename P>
+class config_store final {
+public:
+    using value_type = P;
+    using pointer = std::shared_ptr<P const>;
+
+    class reader final {
+    public:
+        explicit reader(config_store const& store)
+            : store_(store)
+            , version_(store.version())
+            , current_(store.current()) {
+            // EMPTY
+        }
+    public:
+        P const& get() {
+            auto const v = store_.version();
+            if (v != version_) {
+                current_ = store_.current();
+                version_ = v;
+            }
+            return *current_;
+        }
+        P const& operator*() {
+            return get();
+        }
+        P const* operator->() {
+            return &get();
+        }
+    private:
+        config_store const& store_;
+        std::uint64_t version_;
+        pointer current_;
+    };
+public:
+    explicit config_store(std::string const& file)
+        : file_(file)
+        , current_(std::make_shared<P const>()) {
+        reload();
+    }
+    ~config_store() {
+        stop();
+    }
+    config_store(config_store const&) = delete;
+    config_store& operator=(config_store const&) = delete;
+public:
+    std::string const& file() const {
+        return file_;
+    }
+    pointer current() const {
+        return std::atomic_load_explicit(&current_, std::memory_order_acquire);
+    }
+    // bumped after every published snapshot
+    std::uint64_t version() const {
+        return version_.load(std::memory_order_acquire);
+    }
+    reader make_reader() const {
+        return reader{*this};
+    }
+public:
+    // parse the file now, publish it if it holds a valid config
+    bool reload() {
+        std::lock_guard<std::mutex> lock{reload_mutex_};
+        std::error_code ec;
+        auto const j = ::zbb::json_file::load_json(file_, ec);
+        if (ec) {
+            std::cerr << "config_store: " << file_ << ": "
+                      << ec.message() << std::endl;
+            return false;
+        }
+        auto next = std::make_shared<P const>(P::from_json(j));
+        if (!*next) {
+            std::cerr << "config_store: " << file_
+                      << ": not a valid config, kept the previous one"
+                      << std::endl;
+            return false;
+        }
+        publish(std::move(next));
+        return true;
+    }
+    // replace the snapshot without touching the file
+    void publish(pointer next) {
+        std::atomic_store_explicit( &current_
+                                  , std::move(next)
+                                  , std::memory_order_release);
+        version_.fetch_add(1, std::memory_order_acq_rel);
+    }
+public:
+    // reload whenever the file changes, on a thread of its own
+    bool watch(std::chrono::milliseconds period = std::chrono::seconds{1}) {
+        if (watcher_.joinable()) {
+            return true;
+        }
+        working_ = true;
+#if defined(__linux__)
+        (void)period;
+        namespace fs = ::std::filesystem;
+        auto const path = fs::path{file_};
+        auto const dir = path.has_parent_path() ? path.parent_path()
+                                                : fs::path{"."};
+        inotify_ = inotify_init1(IN_CLOEXEC);
+        stop_ = eventfd(0, EFD_CLOEXEC);
+        if ( inotify_ < 0 || stop_ < 0
+          || inotify_add_watch( inotify_
+                              , dir.c_str()
+                              , IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            std::cerr << "config_store: cannot watch " << dir.string()
+                      << std::endl;
+            close_fds();
+            working_ = false;
+            return false;
+        }
+        watcher_ = std::thread{[this, name = path.filename().string()]() {
+            wait_inotify(name);
+        }};
+#else
+        watcher_ = std::thread{[this, period]() {
+            wait_polling(period);
+        }};
+#endif
+        return true;
+    }
+    void stop() {
+        if (!watcher_.joinable()) {
+            return;
+        }
+        working_ = false;
+#if defined(__linux__)
+        std::uint64_t const one = 1;
+        auto const n = ::write(stop_, &one, sizeof(one));
+        (void)n;
+#else
+        {
+            std::lock_guard<std::mutex> lock{wait_mutex_};
+            wait_.notify_all();
+        }
+#endif
+        watcher_.join();
+#if defined(__linux__)
+        close_fds();
+#endif
+    }
+private:
+#if defined(__linux__)
+    void wait_inotify(std::string const& name) {
+        alignas(inotify_event) char buf[4096];
+        pollfd fds[2] = {{inotify_, POLLIN, 0}, {stop_, POLLIN, 0}};
+        for (; working_;) {
+            if (::poll(fds, 2, -1) < 0 || 0 != (fds[1].revents & POLLIN)) {
+                continue;
+            }
+            auto const n = ::read(inotify_, buf, sizeof(buf));
+            auto changed = false;
+            for (auto p = buf; n > 0 && p < buf + n;) {
+                auto const e = reinterpret_cast<inotify_event const*>(p);
+                changed = changed || (0 != e->len && name == e->name);
+                p += sizeof(inotify_event) + e->len;
+            }
+            if (changed) {
+                reload();
+            }
+        }
+    }
+    void close_fds() {
+        if (inotify_ >= 0) {
+            ::close(inotify_);
+            inotify_ = -1;
+        }
+        if (stop_ >= 0) {
+            ::close(stop_);
+            stop_ = -1;
+        }
+    }
+#else
+    void wait_polling(std::chrono::milliseconds period) {
+        namespace fs = ::std::filesystem;
+        std::error_code ec;
+        auto last = fs::last_write_time(fs::path{file_}, ec);
+        std::unique_lock<std::mutex> lock{wait_mutex_};
+        for (; working_;) {
+            wait_.wait_for(lock, period);
+            auto const now = fs::last_write_time(fs::path{file_}, ec);
+            if (!ec && now != last) {
+                last = now;
+                reload();
+            }
+        }
+    }
+#endif
+private:
+    std::string const file_;
+    pointer current_;
+    std::atomic<std::uint64_t> version_{0};
+    std::mutex reload_mutex_;
+    std::thread watcher_;
+    std::atomic<bool> working_{false};
+#if defined(__linux__)
+    int inotify_ = -1;
+    int stop_ = -1;
+#else
+    std::mutex wait_mutex_;
+    std::condition_variable wait_;
+#endif
+};
+
+ZBB_CONFIG_END
+
+
+#endif // ZBB_CONFIG_CONFIG_STORE_HH
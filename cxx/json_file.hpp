@@ -8,38 +8,88 @@
 #define ZBB_JSON_FILE_HPP
 
 
+#include <cstddef>
 #include <cstdint>
+#include <cerrno>
 #include <iostream>
 #include <fstream>
 #include <filesystem>
+#include <string>
 #include <system_error>
 #include "./json.hpp"
 
+#if defined(_WIN32)
+#   ifndef NOMINMAX
+#       define NOMINMAX
+#   endif
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#endif
 
+
+//
+// - Whole JSON files, loaded and saved
+//    - load_json() parses straight out of a read-only mapping of the file,
+//      no copy in between; a file that can not be mapped is streamed
+//      through an ifstream instead. There is no size limit.
+//    - The std::error_code overloads report why a load failed through ec
+//      alone, printing nothing: the OS error, or illegal_byte_sequence for a
+//      parse error. The others print it, a parse error with the parser's
+//      message, and return an empty value as before.
+//    - save_*() write a temporary next to the file, then rename it over.
+//
 namespace zbb {
 struct json_file {
     json_file() = delete;
     ~json_file() = delete;
 
-    static std::string load_bytes(std::string const& file) {
+    // the whole file, one read into the string
+    static std::string load_bytes( std::string const& file
+                                 , std::error_code& ec) {
+        ec.clear();
+        namespace fs = ::std::filesystem;
+        auto const file_size = fs::file_size(fs::path{file}, ec);
+        if (ec) {
+            return std::string{};
+        }
         std::ifstream ifs(file.c_str(), std::ios_base::binary);
-        auto const ifs_size = size(ifs);
-        if (0 == ifs_size || ifs_size > max_size) {
+        if (!ifs) {
+            ec = last_error();
             return std::string{};
         }
-        std::unique_ptr<char[]> buf{new char[ifs_size]};
-        if (!ifs.read(buf.get(), ifs_size)) {
+        std::string bytes(static_cast<std::size_t>(file_size), '\0');
+        if (!bytes.empty() && !ifs.read(&bytes[0], bytes.size())) {
+            ec = std::make_error_code(std::errc::io_error);
             return std::string{};
         }
-        return std::string{buf.get(), ifs_size};
+        return bytes;
+    }
+    static std::string load_bytes(std::string const& file) {
+        std::error_code ec;
+        auto bytes = load_bytes(file, ec);
+        if (ec) {
+            std::cerr << file << ": " << ec.message() << std::endl;
+        }
+        return bytes;
+    }
+    static nlohmann::json load_json( std::string const& file
+                                   , std::error_code& ec) {
+        std::string what;
+        return load_json(file, ec, what);
     }
     static nlohmann::json load_json(std::string const& file) {
-        try {
-            return nlohmann::json::parse(load_bytes(file));
-        } catch(std::exception const& e) {
-            std::cerr << e.what();
-            return nlohmann::json{};
+        std::error_code ec;
+        std::string what;
+        auto j = load_json(file, ec, what);
+        if (ec) {
+            std::cerr << file << ": "
+                      << (what.empty() ? ec.message() : what) << std::endl;
         }
+        return j;
     }
     static bool save_bytes(std::string const& file, std::string const& bytes) {
         if (!make(file)) {
@@ -59,14 +109,153 @@ struct json_file {
             return false;
         }
     }
+private:
+    // what is the parser's message for a parse error
+    static nlohmann::json load_json( std::string const& file
+                                   , std::error_code& ec
+                                   , std::string& what) {
+        ec.clear();
+        try {
+            mapping const m{file, ec};
+            if (ec) {
+                return nlohmann::json{};
+            }
+            if (m.mapped()) {
+                return nlohmann::json::parse(m.begin(), m.end());
+            }
+            std::ifstream ifs(file.c_str(), std::ios_base::binary);
+            if (!ifs) {
+                ec = last_error();
+                return nlohmann::json{};
+            }
+            return nlohmann::json::parse(ifs);
+        } catch(std::exception const& e) {
+            what = e.what();
+            ec = std::make_error_code(std::errc::illegal_byte_sequence);
+            return nlohmann::json{};
+        }
+    }
+    // a read-only view of a file, mapped() is false when the file opened
+    // but could not be mapped (too large for the address space, a pipe)
+    class mapping final {
+    public:
+        mapping(std::string const& file, std::error_code& ec) {
+#if defined(_WIN32)
+            auto const handle = CreateFileA( file.c_str()
+                                           , GENERIC_READ
+                                           , FILE_SHARE_READ
+                                           , nullptr
+                                           , OPEN_EXISTING
+                                           , FILE_FLAG_SEQUENTIAL_SCAN
+                                           , nullptr);
+            if (INVALID_HANDLE_VALUE == handle) {
+                ec = last_error();
+                return;
+            }
+            LARGE_INTEGER size;
+            if ( !GetFileSizeEx(handle, &size)
+              || static_cast<unsigned long long>(size.QuadPart)
+                 > static_cast<std::size_t>(-1)) {
+                CloseHandle(handle);
+                return;
+            }
+            size_ = static_cast<std::size_t>(size.QuadPart);
+            auto const section = 0 == size_
+                               ? nullptr
+                               : CreateFileMappingA( handle
+                                                   , nullptr
+                                                   , PAGE_READONLY
+                                                   , 0
+                                                   , 0
+                                                   , nullptr);
+            CloseHandle(handle);
+            if (nullptr == section) {
+                mapped_ = 0 == size_;
+                return;
+            }
+            auto const view = MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(section);
+            data_ = static_cast<char const*>(view);
+            mapped_ = nullptr != view;
+#else
+            auto const fd = ::open(file.c_str(), O_RDONLY);
+            if (fd < 0) {
+                ec = last_error();
+                return;
+            }
+            struct stat st;
+            if (0 != ::fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+                ::close(fd);
+                return;
+            }
+            size_ = static_cast<std::size_t>(st.st_size);
+            if (0 == size_) {
+                ::close(fd);
+                mapped_ = true;
+                return;
+            }
+            auto const p = ::mmap( nullptr
+                                 , size_
+                                 , PROT_READ
+                                 , MAP_PRIVATE
+                                 , fd
+                                 , 0);
+            ::close(fd);
+            if (MAP_FAILED == p) {
+                return;
+            }
+            ::madvise(p, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<char const*>(p);
+            mapped_ = true;
+#endif
+        }
+        ~mapping() {
+            if (nullptr == data_) {
+                return;
+            }
+#if defined(_WIN32)
+            UnmapViewOfFile(data_);
+#else
+            ::munmap(const_cast<char*>(data_), size_);
+#endif
+        }
+        mapping(mapping const&) = delete;
+        mapping& operator=(mapping const&) = delete;
+    public:
+        bool mapped() const {
+            return mapped_;
+        }
+        // an empty file maps to an empty range
+        char const* begin() const {
+            return nullptr == data_ ? &nothing_ : data_;
+        }
+        char const* end() const {
+            return begin() + (nullptr == data_ ? 0 : size_);
+        }
+    private:
+        char const* data_ = nullptr;
+        std::size_t size_ = 0;
+        bool mapped_ = false;
+        char const nothing_ = 0;
+    };
+
+    static std::error_code last_error() {
+#if defined(_WIN32)
+        return std::error_code( static_cast<int>(GetLastError())
+                              , std::system_category());
+#else
+        return std::error_code(errno, std::generic_category());
+#endif
+    }
 private:
     static bool make(std::string const& file) {
-        namespace fs = ::std::experimental::filesystem;
+        namespace fs = ::std::filesystem;
+        std::error_code ec;
         auto dir = fs::path(file);
         if (dir.empty()) {
             return true;
         }
-        if (fs::exists(dir)) {
+        if (fs::exists(dir, ec)) {
             return true;
         }
         if (dir.has_filename()) {
@@ -75,10 +264,14 @@ private:
         if (dir.empty()) {
             return true;
         }
-        if (fs::exists(dir)) {
+        if (fs::exists(dir, ec)) {
             return true;
         }
-        return fs::create_directories(dir);
+        if (!fs::create_directories(dir, ec) && ec) {
+            std::cerr << dir.string() << ": " << ec.message() << std::endl;
+            return false;
+        }
+        return true;
     }
     static bool write(std::string const& file, std::string const& bytes) {
         try {
@@ -94,31 +287,15 @@ private:
         }
     }
     static bool rename(std::string const& from, std::string const& to) {
-        namespace fs = ::std::experimental::filesystem;
-        try {
-            fs::rename(fs::path{from}, fs::path{to});
-            return true;
-        } catch (std::exception const& e) {
-            std::cerr << e.what();
+        namespace fs = ::std::filesystem;
+        std::error_code ec;
+        fs::rename(fs::path{from}, fs::path{to}, ec);
+        if (ec) {
+            std::cerr << from << ": " << ec.message() << std::endl;
             return false;
         }
+        return true;
     }
-    static std::size_t size(std::ifstream& ifs) {
-        auto const pos = ifs.tellg();
-        ifs.seekg(0, std::ios_base::end);
-        auto const s = static_cast<std::size_t>(ifs.tellg());
-        ifs.seekg(pos, std::ios_base::beg);
-        return s;
-    }
-    static std::size_t size(std::ofstream& ofs) {
-        auto const pos = ofs.tellp();
-        ofs.seekp(0, std::ios_base::end);
-        auto const s = static_cast<std::size_t>(ofs.tellp());
-        ofs.seekp(pos, std::ios_base::beg);
-        return s;
-    }
-private:
-    static auto constexpr max_size = 1024u * 1024u;
 }; // json_file
 } // zbb
 
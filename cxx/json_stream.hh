@@ -0,0 +1,638 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef ZBB_CONFIG_JSON_STREAM_HH
+#define ZBB_CONFIG_JSON_STREAM_HH
+
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <charconv>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <array>
+#include <string_view>
+#include <utility>
+#include <type_traits>
+#include <json.hpp>
+#include "../util/static_iterate.hh"
+#include "./ns.hh"
+
+
+//
+// - JSON straight from and into fields, no nlohmann::json tree in between
+//    - json_writer appends to one string; the field loop is static_iterate
+//      over the tuple or the meta() list, so names and types are fixed at
+//      compile time.
+//    - json_reader is a SAX handler for nlohmann::json::sax_parse(); a key
+//      picks the field through field_lookup, the value goes through a per
+//      type table of assign<I> functions built from an index_sequence.
+//    - json_stream::from_json() walks an nlohmann::json object once the
+//      same way, instead of one at() per field.
+//    - Only bool, numbers and std::string are read this way (see
+//      json_stream::supported); other field types keep the DOM path.
+//    - Fields are written in declaration order, the DOM wrote them sorted.
+//
+ZBB_CONFIG_BEGIN
+
+// fields of a tuple, named by K::get<I>()
+template<typename K, typename T>
+struct tuple_fields {
+    using target_type = T;
+    using list_type = T;
+    static auto constexpr size = std::tuple_size<T>::value;
+
+    static list_type const& list(target_type const& t) {
+        return t;
+    }
+    template<std::size_t I>
+    static std::string_view constexpr name() {
+        return K:: template get<I>();
+    }
+    template<std::size_t I>
+    static auto& at(target_type& t) {
+        return std::get<I>(t);
+    }
+    template<std::size_t I>
+    static auto const& at(target_type const& t) {
+        return std::get<I>(t);
+    }
+    template<std::size_t I>
+    using type = std::tuple_element_t<I, T>;
+};
+
+// fields of a struct, named by the filed list of its meta()
+template<typename T>
+struct meta_fields {
+    using target_type = T;
+    using list_type = std::decay_t<decltype(T::meta())>;
+    static auto constexpr size = std::tuple_size<list_type>::value;
+
+    // The list is built once, as a constant when T::meta() is constexpr
+    // and at start-up otherwise; either way no guard sits on the per field
+    // path.
+    template<typename G, typename = void>
+    struct storage {
+        static inline list_type const meta = G::meta();
+    };
+    template<typename G>
+    struct storage<G, std::enable_if_t<(G::meta(), true)>> {
+        static list_type constexpr meta = G::meta();
+    };
+
+    static list_type const& list() {
+        return storage<T>::meta;
+    }
+    static list_type const& list(target_type const&) {
+        return list();
+    }
+    // constexpr as far as T::meta() is
+    template<std::size_t I>
+    static std::string_view constexpr name() {
+        return std::get<I>(storage<T>::meta).name;
+    }
+    template<std::size_t I>
+    static auto& at(target_type& t) {
+        return t.*(std::get<I>(storage<T>::meta).pointer);
+    }
+    template<std::size_t I>
+    static auto const& at(target_type const& t) {
+        return t.*(std::get<I>(storage<T>::meta).pointer);
+    }
+    template<std::size_t I>
+    using type = typename std::tuple_element_t<I, list_type>::type;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+
+//
+// - Perfect hash from field name to field index
+//    - A seeded FNV-1a, masked to a power of two table; the seed and the
+//      table size are searched until every name has a slot of its own, so
+//      a lookup is one hash, one slot and one compare.
+//    - Built at compile time when the names are constant expressions (a
+//      constexpr K::get<I>() or T::meta()), else once on first use.
+//
+template<typename F>
+struct field_lookup {
+    field_lookup() = delete;
+    ~field_lookup() = delete;
+
+    static auto constexpr size = F::size;
+    static auto constexpr npos = ~std::size_t{0};
+
+    static std::size_t constexpr ceil2(std::size_t n) {
+        std::size_t p = 1;
+        for (; p < n;) {
+            p <<= 1;
+        }
+        return p;
+    }
+    // room for a quarter load, which finds a seed within a few tries
+    static auto constexpr capacity = ceil2(4 * size);
+    static auto constexpr empty = std::uint16_t{0xffff};
+    static_assert(size < empty, "too many fields");
+
+    struct table {
+        std::array<std::string_view, size> names{};
+        std::array<std::uint16_t, capacity> slots{};
+        std::uint32_t seed = 0;
+        std::size_t mask = 0;
+    };
+
+    static std::uint32_t constexpr hash( std::string_view s
+                                       , std::uint32_t seed) {
+        auto h = 2166136261u ^ (seed * 0x9e3779b9u);
+        for (auto const c : s) {
+            h = (h ^ static_cast<std::uint8_t>(c)) * 16777619u;
+        }
+        return h ^ (h >> 15);
+    }
+
+    template<std::size_t ... Is>
+    static table constexpr build(std::index_sequence<Is ...>) {
+        table t;
+        t.names = {{F:: template name<Is>() ...}};
+        for (auto slots = ceil2(size); slots <= capacity; slots <<= 1) {
+            for (std::uint32_t seed = 0; seed < 1024; ++seed) {
+                if (place(t, seed, slots - 1)) {
+                    return t;
+                }
+            }
+        }
+        // Only equal names get here, the first of them wins.
+        place(t, 0, capacity - 1);
+        return t;
+    }
+
+    static bool constexpr place( table& t
+                               , std::uint32_t seed
+                               , std::size_t mask) {
+        for (auto& slot : t.slots) {
+            slot = empty;
+        }
+        for (std::size_t i = 0; i < size; ++i) {
+            auto& slot = t.slots[hash(t.names[i], seed) & mask];
+            if (empty == slot) {
+                slot = static_cast<std::uint16_t>(i);
+            } else if (t.names[slot] != t.names[i]) {
+                return false;
+            }
+        }
+        t.seed = seed;
+        t.mask = mask;
+        return true;
+    }
+
+    static table constexpr build() {
+        return build(std::make_index_sequence<size>{});
+    }
+
+    template<typename G>
+    static table constexpr build_for() {
+        return build();
+    }
+
+    // names known at run time only
+    template<typename G, typename = void>
+    struct storage {
+        static table const& get() {
+            static auto const t = build_for<G>();
+            return t;
+        }
+    };
+
+    // names known at compile time, the table is a constant
+    template<typename G>
+    struct storage<G, std::enable_if_t<(build_for<G>(), true)>> {
+        static table constexpr t = build_for<G>();
+        static table const& get() {
+            return t;
+        }
+    };
+
+    static std::size_t find(std::string_view key) {
+        auto const& t = storage<F>::get();
+        auto const i = t.slots[hash(key, t.seed) & t.mask];
+        if (empty == i || t.names[i] != key) {
+            return npos;
+        }
+        return i;
+    }
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+
+// the layout of nlohmann::json::dump(indent), appended to out
+class json_writer final {
+public:
+    json_writer(std::string& out, int indent)
+        : out_(out)
+        , indent_(indent) {
+        // EMPTY
+    }
+public:
+    void begin_object() {
+        out_ += '{';
+        first_ = true;
+    }
+    void end_object() {
+        if (!first_ && indent_ >= 0) {
+            out_ += '\n';
+        }
+        out_ += '}';
+    }
+    void key(std::string_view k) {
+        if (!first_) {
+            out_ += ',';
+        }
+        first_ = false;
+        if (indent_ >= 0) {
+            out_ += '\n';
+            out_.append(static_cast<std::size_t>(indent_), ' ');
+        }
+        value(k.data(), k.size());
+        out_ += ':';
+        if (indent_ >= 0) {
+            out_ += ' ';
+        }
+    }
+public:
+    void value(bool b) {
+        out_ += b ? "true" : "false";
+    }
+    void value(std::string const& s) {
+        value(s.data(), s.size());
+    }
+    void value(char const* s) {
+        value(s, std::char_traits<char>::length(s));
+    }
+    void value(char const* s, std::size_t size) {
+        static char const hex[] = "0123456789abcdef";
+        out_ += '"';
+        auto begin = s;
+        auto const end = s + size;
+        for (auto p = s; p != end; ++p) {
+            auto const c = static_cast<unsigned char>(*p);
+            if (c >= 0x20 && '"' != c && '\\' != c) {
+                continue;
+            }
+            out_.append(begin, p);
+            begin = p + 1;
+            out_ += '\\';
+            switch (c) {
+            case '"': out_ += '"'; break;
+            case '\\': out_ += '\\'; break;
+            case '\b': out_ += 'b'; break;
+            case '\f': out_ += 'f'; break;
+            case '\n': out_ += 'n'; break;
+            case '\r': out_ += 'r'; break;
+            case '\t': out_ += 't'; break;
+            default:
+                out_ += "u00";
+                out_ += hex[c >> 4];
+                out_ += hex[c & 0x0f];
+                break;
+            }
+        }
+        out_.append(begin, end);
+        out_ += '"';
+    }
+    template< typename T
+            , typename = std::enable_if_t<( std::is_integral<T>::value
+                                         && !std::is_same<T, bool>::value)>
+            , typename = void
+            >
+    void value(T v) {
+        char buf[24];
+        auto const r = std::to_chars(buf, buf + sizeof(buf), v);
+        out_.append(buf, r.ptr);
+    }
+    // shortest round trip, with ".0" kept on whole numbers the way the
+    // DOM wrote them; NaN and infinities have no JSON spelling
+    template< typename T
+            , typename = std::enable_if_t<std::is_floating_point<T>::value>
+            , typename = void
+            , typename = void
+            >
+    void value(T v) {
+        if (!std::isfinite(v)) {
+            out_ += "null";
+            return;
+        }
+        char buf[32];
+        auto const r = std::to_chars(buf, buf + sizeof(buf), v);
+        std::string const s{buf, r.ptr};
+        out_ += s;
+        if (std::string::npos == s.find_first_of(".eE")) {
+            out_ += ".0";
+        }
+    }
+    // anything else goes through its nlohmann to_json()
+    template< typename T
+            , typename = std::enable_if_t<( !std::is_arithmetic<T>::value
+                                         && !std::is_convertible< T const&
+                                                                , std::string
+                                                                >::value)>
+            , typename = void
+            , typename = void
+            , typename = void
+            >
+    void value(T const& v) {
+        auto const dumped = ::nlohmann::json(v).dump(indent_);
+        if (indent_ <= 0) {
+            out_ += dumped;
+            return;
+        }
+        // nested one level deeper than dump() assumed
+        for (auto const c : dumped) {
+            out_ += c;
+            if ('\n' == c) {
+                out_.append(static_cast<std::size_t>(indent_), ' ');
+            }
+        }
+    }
+private:
+    std::string& out_;
+    int indent_;
+    bool first_ = true;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+
+// SAX handler filling the fields of one object
+template<typename F>
+class json_reader final {
+public:
+    using fields_type = F;
+    using target_type = typename F::target_type;
+    static auto constexpr size = F::size;
+public:
+    explicit json_reader(target_type& target)
+        : target_(target) {
+        // EMPTY
+    }
+public:
+    // every field was given a value
+    bool complete() const {
+        return size == filled_;
+    }
+public:
+    bool null() {
+        return skipped();
+    }
+    bool boolean(bool v) {
+        return scalar(table<bool>, v);
+    }
+    bool number_integer(std::int64_t v) {
+        return scalar(table<std::int64_t>, v);
+    }
+    bool number_unsigned(std::uint64_t v) {
+        return scalar(table<std::uint64_t>, v);
+    }
+    bool number_float(double v, std::string const&) {
+        return scalar(table<double>, v);
+    }
+    bool string(std::string& v) {
+        return scalar(table<std::string>, v);
+    }
+    template<typename B>
+    bool binary(B&) {
+        return skipped();
+    }
+    bool start_object(std::size_t) {
+        return nested(true);
+    }
+    bool end_object() {
+        --depth_;
+        return true;
+    }
+    bool start_array(std::size_t) {
+        return nested(false);
+    }
+    bool end_array() {
+        --depth_;
+        return true;
+    }
+    bool key(std::string& k) {
+        if (1 == depth_) {
+            index_ = lookup(k);
+        }
+        return true;
+    }
+    template<typename E>
+    bool parse_error(std::size_t, std::string const&, E const& e) {
+        std::cerr << "json_reader error: " << e.what() << std::endl;
+        return false;
+    }
+private:
+    // the value of an unknown key, or anything below one
+    bool skipped() const {
+        return depth_ > 1 || (1 == depth_ && npos == index_);
+    }
+    // the top level object, or an object or array an unknown key holds
+    bool nested(bool object) {
+        if ((0 == depth_ && !object) || (1 == depth_ && npos != index_)) {
+            return false;
+        }
+        ++depth_;
+        return true;
+    }
+    template<typename T, typename V>
+    bool scalar(T const& table, V& v) {
+        if (skipped()) {
+            return true;
+        }
+        if (1 != depth_ || !table[index_](target_, v)) {
+            return false;
+        }
+        if (!seen_[index_]) {
+            seen_[index_] = true;
+            ++filled_;
+        }
+        return true;
+    }
+private:
+    static auto constexpr npos = ~std::size_t{0};
+
+    static std::size_t lookup(std::string const& k) {
+        return field_lookup<F>::find(k);
+    }
+private:
+    template<typename V>
+    using setter_type = bool (*)(target_type&, V&);
+
+    template<std::size_t I, typename V>
+    static bool assign(target_type& t, V& v) {
+        return convert(F:: template at<I>(t), v, 0);
+    }
+    template<typename V, std::size_t ... Is>
+    static std::array<setter_type<V>, size> constexpr make_table
+        (std::index_sequence<Is ...>) {
+        return {{&json_reader:: template assign<Is, V> ...}};
+    }
+    // one assign<I> per field and SAX value type, resolved at compile time
+    template<typename V>
+    static std::array<setter_type<V>, size> constexpr table
+            = make_table<V>(std::make_index_sequence<size>{});
+private:
+    // what nlohmann's get<E>() accepts: any number or bool for a number,
+    // a bool for a bool, a string for a string
+    template< typename E
+            , typename V
+            , typename = std::enable_if_t<( std::is_arithmetic<E>::value
+                                         && !std::is_same<E, bool>::value
+                                         && std::is_arithmetic<V>::value)>
+            >
+    static bool convert(E& e, V& v, int) {
+        e = static_cast<E>(v);
+        return true;
+    }
+    static bool convert(bool& e, bool& v, int) {
+        e = v;
+        return true;
+    }
+    static bool convert(std::string& e, std::string& v, int) {
+        e = std::move(v);
+        return true;
+    }
+    template<typename E, typename V>
+    static bool convert(E&, V&, long) {
+        return false;
+    }
+private:
+    target_type& target_;
+    std::size_t depth_ = 0;
+    std::size_t index_ = npos;
+    std::size_t filled_ = 0;
+    std::array<bool, size> seen_{};
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+
+template<typename F>
+struct json_stream {
+    json_stream() = delete;
+    ~json_stream() = delete;
+
+    using fields_type = F;
+    using target_type = typename F::target_type;
+
+    template<std::size_t I>
+    using field_type = typename F:: template type<I>;
+
+    template<typename T>
+    static bool constexpr readable = std::is_arithmetic<T>::value
+                                  || std::is_same<T, std::string>::value;
+
+    // json_reader can fill every field
+    template<std::size_t ... Is>
+    static bool constexpr all_readable(std::index_sequence<Is ...>) {
+        return (true && ... && readable<field_type<Is>>);
+    }
+    static bool constexpr supported
+            = all_readable(std::make_index_sequence<F::size>{});
+
+    struct write_predicate {
+        write_predicate(json_writer& w, target_type const& t)
+            : w_(w)
+            , t_(t) {
+            // EMPTY
+        }
+        template<std::size_t I, typename E>
+        bool apply(E const&) {
+            w_.key(F:: template name<I>());
+            w_.value(F:: template at<I>(t_));
+            return true;
+        }
+    private:
+        json_writer& w_;
+        target_type const& t_;
+    };
+
+    using setter_type = void (*)(target_type&, ::nlohmann::json const&);
+
+    template<std::size_t I>
+    static void assign(target_type& t, ::nlohmann::json const& j) {
+        F:: template at<I>(t) = j. template get<field_type<I>>();
+    }
+    template<std::size_t ... Is>
+    static std::array<setter_type, F::size> constexpr make_setters
+        (std::index_sequence<Is ...>) {
+        return {{&json_stream:: template assign<Is> ...}};
+    }
+    static std::array<setter_type, F::size> constexpr setters
+            = make_setters(std::make_index_sequence<F::size>{});
+
+    // indent < 0 is the compact form
+    static std::string encode(target_type const& t, int indent) {
+        try {
+            std::string out;
+            out.reserve(32 * F::size);
+            json_writer w{out, indent};
+            w.begin_object();
+            ::zbb::util::static_iterate(F::list(t), write_predicate{w, t});
+            w.end_object();
+            return out;
+        } catch (std::exception const& e) {
+            std::cerr << "json_stream encode error: "
+                      << e.what()
+                      << std::endl;
+            return std::string{};
+        }
+    }
+
+    // one pass over the members of j, throws what get<E>() throws;
+    // complete tells whether every field was among them
+    static bool from_json( ::nlohmann::json const& j
+                         , target_type& t
+                         , bool& complete) {
+        if (!j.is_object()) {
+            return false;
+        }
+        std::array<bool, F::size> seen{};
+        std::size_t filled = 0;
+        for (auto it = j.begin(); it != j.end(); ++it) {
+            auto const i = field_lookup<F>::find(it.key());
+            if (field_lookup<F>::npos == i) {
+                continue;
+            }
+            setters[i](t, it.value());
+            if (!seen[i]) {
+                seen[i] = true;
+                ++filled;
+            }
+        }
+        complete = F::size == filled;
+        return true;
+    }
+
+    // fills what bytes hold, complete tells whether that was every field
+    static bool decode( std::string const& bytes
+                      , target_type& t
+                      , bool& complete) {
+        json_reader<F> reader{t};
+        auto const parsed = ::nlohmann::json::sax_parse(bytes, &reader);
+        complete = reader.complete();
+        return parsed;
+    }
+};
+
+ZBB_CONFIG_END
+
+
+#endif // ZBB_CONFIG_JSON_STREAM_HH
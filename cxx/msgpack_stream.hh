@@ -0,0 +1,624 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef ZBB_CONFIG_MSGPACK_STREAM_HH
+#define ZBB_CONFIG_MSGPACK_STREAM_HH
+
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <initializer_list>
+#include <type_traits>
+#include <json.hpp>
+#include "../util/static_iterate.hh"
+#include "./ns.hh"
+
+
+//
+// - MessagePack for property tuples, written and read field by field
+//    - A tuple is an array, its schema id first and then every field by
+//      position; keys are not sent, the schema id stands in for them.
+//    - The schema id hashes the field count and each field's kind and
+//      size, so a reader built from a different tuple type refuses the
+//      bytes instead of misreading them.
+//    - Tuples of trivially copyable fields only skip the per field
+//      encoding: one ext value (type raw_ext) holds the schema id and the
+//      fields memcpy'd back to back, in the writer's byte order.
+//    - Fields other than bool, numbers and std::string are written with
+//      nlohmann's to_msgpack() and read back through its DOM.
+//
+ZBB_CONFIG_BEGIN
+
+// what a field contributes to the schema id
+template<typename T>
+struct msgpack_kind {
+    static std::uint32_t constexpr kind = std::is_same<T, bool>::value
+                                        ? 1
+                                        : std::is_integral<T>::value
+                                        ? (std::is_signed<T>::value ? 2 : 3)
+                                        : std::is_floating_point<T>::value
+                                        ? 4
+                                        : std::is_same<T, std::string>::value
+                                        ? 5
+                                        : 6;
+    // sizes of non trivially copyable types differ between libraries
+    static std::uint32_t constexpr size = std::is_trivially_copyable<T>::value
+                                        ? static_cast<std::uint32_t>
+                                          (sizeof(T))
+                                        : 0;
+    static std::uint32_t constexpr value = (kind << 24) | size;
+};
+
+// FNV-1a over the field count and each field's msgpack_kind
+template<typename ... Ts>
+struct msgpack_schema {
+    static std::uint32_t constexpr mix(std::uint32_t h, std::uint32_t v) {
+        for (auto i = 0; i < 4; ++i) {
+            h = (h ^ (v & 0xff)) * 16777619u;
+            v >>= 8;
+        }
+        return h;
+    }
+    static std::uint32_t constexpr hash() {
+        std::uint32_t const fields[] = {0u, msgpack_kind<Ts>::value ...};
+        auto h = mix(2166136261u, sizeof...(Ts));
+        for (std::size_t i = 1; i <= sizeof...(Ts); ++i) {
+            h = mix(h, fields[i]);
+        }
+        return h;
+    }
+    static std::uint32_t constexpr value = hash();
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+
+// MessagePack values appended to out, integers in their smallest form
+class msgpack_writer final {
+public:
+    explicit msgpack_writer(std::string& out)
+        : out_(out) {
+        // EMPTY
+    }
+public:
+    void array(std::size_t n) {
+        if (n < 16) {
+            byte(0x90 | n);
+        } else if (n <= 0xffff) {
+            byte(0xdc);
+            big_endian(n, 2);
+        } else {
+            byte(0xdd);
+            big_endian(n, 4);
+        }
+    }
+    void ext(std::int8_t type, std::size_t n) {
+        switch (n) {
+        case 1: byte(0xd4); break;
+        case 2: byte(0xd5); break;
+        case 4: byte(0xd6); break;
+        case 8: byte(0xd7); break;
+        case 16: byte(0xd8); break;
+        default:
+            if (n <= 0xff) {
+                byte(0xc7);
+                big_endian(n, 1);
+            } else if (n <= 0xffff) {
+                byte(0xc8);
+                big_endian(n, 2);
+            } else {
+                byte(0xc9);
+                big_endian(n, 4);
+            }
+            break;
+        }
+        byte(static_cast<std::uint8_t>(type));
+    }
+public:
+    void value(bool b) {
+        byte(b ? 0xc3 : 0xc2);
+    }
+    void value(std::string const& s) {
+        auto const n = s.size();
+        if (n < 32) {
+            byte(0xa0 | n);
+        } else if (n <= 0xff) {
+            byte(0xd9);
+            big_endian(n, 1);
+        } else if (n <= 0xffff) {
+            byte(0xda);
+            big_endian(n, 2);
+        } else {
+            byte(0xdb);
+            big_endian(n, 4);
+        }
+        out_ += s;
+    }
+    template< typename T
+            , typename = std::enable_if_t<( std::is_integral<T>::value
+                                         && !std::is_same<T, bool>::value)>
+            , typename = void
+            >
+    void value(T v) {
+        if (v >= 0) {
+            unsigned_value(static_cast<std::uint64_t>(v));
+        } else {
+            signed_value(static_cast<std::int64_t>(v));
+        }
+    }
+    void value(float v) {
+        std::uint32_t u;
+        memcpy(&u, &v, sizeof(u));
+        byte(0xca);
+        big_endian(u, 4);
+    }
+    void value(double v) {
+        std::uint64_t u;
+        memcpy(&u, &v, sizeof(u));
+        byte(0xcb);
+        big_endian(u, 8);
+    }
+    void value(long double v) {
+        value(static_cast<double>(v));
+    }
+    template< typename T
+            , typename = std::enable_if_t<( !std::is_arithmetic<T>::value
+                                         && !std::is_same< T
+                                                         , std::string
+                                                         >::value)>
+            , typename = void
+            , typename = void
+            >
+    void value(T const& v) {
+        ::nlohmann::json::to_msgpack(::nlohmann::json(v), out_);
+    }
+private:
+    void unsigned_value(std::uint64_t v) {
+        if (v < 0x80) {
+            byte(v);
+        } else if (v <= 0xff) {
+            byte(0xcc);
+            big_endian(v, 1);
+        } else if (v <= 0xffff) {
+            byte(0xcd);
+            big_endian(v, 2);
+        } else if (v <= 0xffffffff) {
+            byte(0xce);
+            big_endian(v, 4);
+        } else {
+            byte(0xcf);
+            big_endian(v, 8);
+        }
+    }
+    void signed_value(std::int64_t v) {
+        auto const u = static_cast<std::uint64_t>(v);
+        if (v >= -32) {
+            byte(u);
+        } else if (v >= INT8_MIN) {
+            byte(0xd0);
+            big_endian(u, 1);
+        } else if (v >= INT16_MIN) {
+            byte(0xd1);
+            big_endian(u, 2);
+        } else if (v >= INT32_MIN) {
+            byte(0xd2);
+            big_endian(u, 4);
+        } else {
+            byte(0xd3);
+            big_endian(u, 8);
+        }
+    }
+    void byte(std::uint64_t b) {
+        out_ += static_cast<char>(b & 0xff);
+    }
+    void big_endian(std::uint64_t v, std::size_t n) {
+        for (auto i = n; i > 0; --i) {
+            byte(v >> ((i - 1) * 8));
+        }
+    }
+private:
+    std::string& out_;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+
+// MessagePack values read in place, nothing is allocated but strings
+class msgpack_reader final {
+public:
+    msgpack_reader(char const* bytes, std::size_t size)
+        : p_(reinterpret_cast<std::uint8_t const*>(bytes))
+        , end_(p_ + size) {
+        // EMPTY
+    }
+public:
+    bool done() const {
+        return p_ == end_;
+    }
+    bool array(std::size_t& n) {
+        std::uint8_t b;
+        if (!byte(b)) {
+            return false;
+        }
+        if (0x90 == (b & 0xf0)) {
+            n = b & 0x0f;
+            return true;
+        }
+        std::uint64_t v;
+        if (0xdc == b && big_endian(2, v)) {
+            n = static_cast<std::size_t>(v);
+            return true;
+        }
+        if (0xdd == b && big_endian(4, v)) {
+            n = static_cast<std::size_t>(v);
+            return true;
+        }
+        return false;
+    }
+    // the payload of an ext value of the given type and size
+    char const* ext(std::int8_t type, std::size_t n) {
+        std::uint8_t b;
+        if (!byte(b)) {
+            return nullptr;
+        }
+        std::uint64_t size = 0;
+        switch (b) {
+        case 0xd4: size = 1; break;
+        case 0xd5: size = 2; break;
+        case 0xd6: size = 4; break;
+        case 0xd7: size = 8; break;
+        case 0xd8: size = 16; break;
+        case 0xc7:
+            if (!big_endian(1, size)) {
+                return nullptr;
+            }
+            break;
+        case 0xc8:
+            if (!big_endian(2, size)) {
+                return nullptr;
+            }
+            break;
+        case 0xc9:
+            if (!big_endian(4, size)) {
+                return nullptr;
+            }
+            break;
+        default:
+            return nullptr;
+        }
+        std::uint8_t t;
+        if (!byte(t) || static_cast<std::int8_t>(t) != type || size != n
+            || static_cast<std::size_t>(end_ - p_) < n) {
+            return nullptr;
+        }
+        auto const payload = reinterpret_cast<char const*>(p_);
+        p_ += n;
+        return payload;
+    }
+public:
+    // what nlohmann's get<E>() accepts: any number or bool for a number,
+    // a bool for a bool, a string for a string
+    template< typename T
+            , typename = std::enable_if_t<( std::is_arithmetic<T>::value
+                                         && !std::is_same<T, bool>::value)>
+            >
+    bool read(T& v) {
+        std::uint8_t b;
+        if (!byte(b)) {
+            return false;
+        }
+        if (b < 0x80 || b >= 0xe0) {
+            v = static_cast<T>(static_cast<std::int8_t>(b));
+            return true;
+        }
+        std::uint64_t u;
+        switch (b) {
+        case 0xc2: v = static_cast<T>(false); return true;
+        case 0xc3: v = static_cast<T>(true); return true;
+        case 0xcc: return number<std::uint8_t>(1, v);
+        case 0xcd: return number<std::uint16_t>(2, v);
+        case 0xce: return number<std::uint32_t>(4, v);
+        case 0xcf: return number<std::uint64_t>(8, v);
+        case 0xd0: return number<std::int8_t>(1, v);
+        case 0xd1: return number<std::int16_t>(2, v);
+        case 0xd2: return number<std::int32_t>(4, v);
+        case 0xd3: return number<std::int64_t>(8, v);
+        case 0xca:
+            if (big_endian(4, u)) {
+                auto const bits = static_cast<std::uint32_t>(u);
+                float f;
+                memcpy(&f, &bits, sizeof(f));
+                v = static_cast<T>(f);
+                return true;
+            }
+            return false;
+        case 0xcb:
+            if (big_endian(8, u)) {
+                double d;
+                memcpy(&d, &u, sizeof(d));
+                v = static_cast<T>(d);
+                return true;
+            }
+            return false;
+        default:
+            return false;
+        }
+    }
+    bool read(bool& v) {
+        std::uint8_t b;
+        if (!byte(b) || (0xc2 != b && 0xc3 != b)) {
+            return false;
+        }
+        v = 0xc3 == b;
+        return true;
+    }
+    bool read(std::string& v) {
+        std::uint8_t b;
+        if (!byte(b)) {
+            return false;
+        }
+        std::uint64_t n = 0;
+        if (0xa0 == (b & 0xe0)) {
+            n = b & 0x1f;
+        } else if (!( (0xd9 == b && big_endian(1, n))
+                   || (0xda == b && big_endian(2, n))
+                   || (0xdb == b && big_endian(4, n)))) {
+            return false;
+        }
+        if (static_cast<std::uint64_t>(end_ - p_) < n) {
+            return false;
+        }
+        v.assign(reinterpret_cast<char const*>(p_)
+                , static_cast<std::size_t>(n));
+        p_ += n;
+        return true;
+    }
+private:
+    template<typename W, typename T>
+    bool number(std::size_t n, T& v) {
+        std::uint64_t u;
+        if (!big_endian(n, u)) {
+            return false;
+        }
+        v = static_cast<T>(static_cast<W>(u));
+        return true;
+    }
+    bool byte(std::uint8_t& b) {
+        if (p_ == end_) {
+            return false;
+        }
+        b = *p_++;
+        return true;
+    }
+    bool big_endian(std::size_t n, std::uint64_t& v) {
+        if (static_cast<std::size_t>(end_ - p_) < n) {
+            return false;
+        }
+        v = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            v = (v << 8) | p_[i];
+        }
+        p_ += n;
+        return true;
+    }
+private:
+    std::uint8_t const* p_;
+    std::uint8_t const* end_;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+
+template<typename ... Ts>
+struct msgpack_stream {
+    msgpack_stream() = delete;
+    ~msgpack_stream() = delete;
+
+    using value_type = std::tuple<Ts ...>;
+
+    static auto constexpr schema = msgpack_schema<Ts ...>::value;
+
+    // the ext type of the memcpy form
+    static std::int8_t constexpr raw_ext = 0x50;
+
+    template<typename T>
+    static bool constexpr copyable = std::is_trivially_copyable<T>::value
+                                  && !std::is_pointer<T>::value;
+    template<typename T>
+    static bool constexpr readable = std::is_arithmetic<T>::value
+                                  || std::is_same<T, std::string>::value;
+
+    static bool constexpr all(std::initializer_list<bool> each) {
+        for (auto const b : each) {
+            if (!b) {
+                return false;
+            }
+        }
+        return true;
+    }
+    // every field memcpy'd, one ext value
+    static bool constexpr raw = all({copyable<Ts> ...});
+    // every field read by msgpack_reader, no DOM
+    static bool constexpr supported = all({readable<Ts> ...});
+
+    static auto constexpr raw_size = (std::size_t{0} + ... + sizeof(Ts));
+    static auto constexpr raw_payload = sizeof(schema) + raw_size;
+
+    struct write_predicate {
+        explicit write_predicate(msgpack_writer& w)
+            : w_(w) {
+            // EMPTY
+        }
+        template<std::size_t I, typename E>
+        bool apply(E const& element) {
+            w_.value(element);
+            return true;
+        }
+    private:
+        msgpack_writer& w_;
+    };
+
+    struct read_predicate {
+        explicit read_predicate(msgpack_reader& r)
+            : r_(r) {
+            // EMPTY
+        }
+        template<std::size_t I, typename E>
+        bool apply(E& element) {
+            return r_.read(element);
+        }
+    private:
+        msgpack_reader& r_;
+    };
+
+    struct copy_out_predicate {
+        explicit copy_out_predicate(char* to)
+            : to_(to) {
+            // EMPTY
+        }
+        template<std::size_t I, typename E>
+        bool apply(E const& element) {
+            memcpy(to_, &element, sizeof(E));
+            to_ += sizeof(E);
+            return true;
+        }
+    private:
+        char* to_;
+    };
+
+    struct copy_in_predicate {
+        explicit copy_in_predicate(char const* from)
+            : from_(from) {
+            // EMPTY
+        }
+        template<std::size_t I, typename E>
+        bool apply(E& element) {
+            memcpy(&element, from_, sizeof(E));
+            from_ += sizeof(E);
+            return true;
+        }
+    private:
+        char const* from_;
+    };
+
+    struct from_json_predicate {
+        explicit from_json_predicate(::nlohmann::json const& j)
+            : j_(j) {
+            // EMPTY
+        }
+        template<std::size_t I, typename E>
+        bool apply(E& element) {
+            element = j_.at(I + 1). template get<E>();
+            return true;
+        }
+    private:
+        ::nlohmann::json const& j_;
+    };
+
+    static std::string encode(value_type const& v) {
+        return encode(v, std::integral_constant<bool, raw>{});
+    }
+
+    static bool decode(std::string const& bytes, value_type& v) {
+        try {
+            return decode( bytes
+                         , v
+                         , std::integral_constant<bool, raw>{}
+                         , std::integral_constant<bool, supported>{});
+        } catch (std::exception const& e) {
+            std::cerr << "msgpack_stream decode error: "
+                      << e.what()
+                      << std::endl;
+            return false;
+        }
+    }
+private:
+    static std::string encode(value_type const& v, std::true_type) {
+        std::string out;
+        msgpack_writer w{out};
+        w.ext(raw_ext, raw_payload);
+        auto const header = out.size();
+        out.resize(header + raw_payload);
+        memcpy(&out[header], &schema, sizeof(schema));
+        ::zbb::util::static_iterate
+                (v, copy_out_predicate{&out[header + sizeof(schema)]});
+        return out;
+    }
+
+    static std::string encode(value_type const& v, std::false_type) {
+        try {
+            std::string out;
+            msgpack_writer w{out};
+            w.array(1 + sizeof...(Ts));
+            w.value(schema);
+            ::zbb::util::static_iterate(v, write_predicate{w});
+            return out;
+        } catch (std::exception const& e) {
+            std::cerr << "msgpack_stream encode error: "
+                      << e.what()
+                      << std::endl;
+            return std::string{};
+        }
+    }
+
+    template<typename S>
+    static bool decode( std::string const& bytes
+                      , value_type& v
+                      , std::true_type
+                      , S) {
+        msgpack_reader r{bytes.data(), bytes.size()};
+        auto const payload = r.ext(raw_ext, raw_payload);
+        if (nullptr == payload || !r.done()) {
+            return false;
+        }
+        std::uint32_t id;
+        memcpy(&id, payload, sizeof(id));
+        if (schema != id) {
+            return false;
+        }
+        return ::zbb::util::static_iterate
+                       (v, copy_in_predicate{payload + sizeof(schema)});
+    }
+
+    static bool decode( std::string const& bytes
+                      , value_type& v
+                      , std::false_type
+                      , std::true_type) {
+        msgpack_reader r{bytes.data(), bytes.size()};
+        std::size_t n = 0;
+        std::uint32_t id = 0;
+        if ( !r.array(n) || 1 + sizeof...(Ts) != n
+          || !r.read(id) || schema != id) {
+            return false;
+        }
+        return ::zbb::util::static_iterate(v, read_predicate{r}) && r.done();
+    }
+
+    static bool decode( std::string const& bytes
+                      , value_type& v
+                      , std::false_type
+                      , std::false_type) {
+        auto const j = ::nlohmann::json::from_msgpack(bytes);
+        if ( !j.is_array() || 1 + sizeof...(Ts) != j.size()
+          || schema != j.at(0). template get<std::uint32_t>()) {
+            return false;
+        }
+        return ::zbb::util::static_iterate(v, from_json_predicate{j});
+    }
+};
+
+ZBB_CONFIG_END
+
+
+#endif // ZBB_CONFIG_MSGPACK_STREAM_HH
@@ -11,8 +11,11 @@
 
 #include <iostream>
 #include <tuple>
+#include <type_traits>
 #include <json.hpp>
 #include "../util/static_iterate.hh"
+#include "./json_stream.hh"
+#include "./msgpack_stream.hh"
 #include "./ns.hh"
 
 #define ZBB_CONFIG_PROPERTIES_FORMAT_PRETTY 1
@@ -20,6 +23,11 @@
 
 ZBB_CONFIG_BEGIN
 
+// the json_writer indent of serialize(), -1 is the compact form
+static int constexpr properties_indent = ZBB_CONFIG_PROPERTIES_FORMAT_PRETTY
+                                       ? 4
+                                       : -1;
+
 template<typename K, typename ... Ts>
 struct properties_codec {
     properties_codec() = delete;
@@ -28,6 +36,8 @@ struct properties_codec {
     using key_type = K;
     using value_type = std::tuple<Ts ...>;
     using self_type = properties_codec<K, Ts ...>;
+    using stream_type = json_stream<tuple_fields<K, value_type>>;
+    using msgpack_type = msgpack_stream<Ts ...>;
 
     struct to_json_predicate {
         explicit to_json_predicate(nlohmann::json& j)
@@ -51,38 +61,24 @@ struct properties_codec {
         ::nlohmann::json& j_;
     };
 
-    struct from_json_predicate {
-        explicit from_json_predicate(nlohmann::json const& j)
-            : j_(j) {
-            // EMPTY
-        }
-        template<std::size_t I, typename E>
-        bool apply(E& element) {
-            try {
-                auto const key = key_type:: template get<I>();
-                element = j_.at(key). template get<E>();
-                return true;
-            } catch (std::exception const& e) {
-                std::cerr << "from_json_predicate error: "
-                          << e.what()
-                          << std::endl;
-                return false;
-            }
-            return false;
-        }
-    private:
-        nlohmann::json const& j_;
-    };
-
+    // one pass over the members of j, see json_stream::from_json()
     static value_type from_json(::nlohmann::json const& j) {
         if (j.is_null()) {
             return value_type{};
         }
-        value_type v;
-        if (!::zbb::util::static_iterate(v, from_json_predicate{j})) {
-            return value_type{};
-        } else {
+        try {
+            value_type v;
+            auto complete = false;
+            if (!stream_type::from_json(j, v, complete) || !complete) {
+                std::cerr << "from_json error: missing fields" << std::endl;
+                return value_type{};
+            }
             return v;
+        } catch (std::exception const& e) {
+            std::cerr << "from_json error: "
+                      << e.what()
+                      << std::endl;
+            return value_type{};
         }
     }
 
@@ -94,19 +90,52 @@ struct properties_codec {
         return j;
     }
 
+    // written field by field, no nlohmann::json in between
     static std::string encode(value_type const& v) {
-        auto const j = to_json(v);
-        if (j.is_null()) {
-            return std::string{};
-        }
-#if ZBB_CONFIG_PROPERTIES_FORMAT_PRETTY
-        return j.dump(4);
-#else
-        return j.dump();
-#endif
+        return stream_type::encode(v, properties_indent);
     }
 
     static value_type decode(std::string const& s) {
+        return decode(s, std::integral_constant< bool
+                                               , stream_type::supported
+                                               >{});
+    }
+
+    // binary, see msgpack_stream
+    static std::string encode_msgpack(value_type const& v) {
+        return msgpack_type::encode(v);
+    }
+
+    static value_type decode_msgpack(std::string const& s) {
+        value_type v;
+        if (!msgpack_type::decode(s, v)) {
+            return value_type{};
+        }
+        return v;
+    }
+private:
+    // bools, numbers and strings only, parsed by SAX straight into the tuple
+    static value_type decode(std::string const& s, std::true_type) {
+        try {
+            value_type v;
+            auto complete = false;
+            if (!stream_type::decode(s, v, complete)) {
+                return value_type{};
+            }
+            if (!complete) {
+                std::cerr << "decode error: missing fields" << std::endl;
+                return value_type{};
+            }
+            return v;
+        } catch (std::exception const& e) {
+            std::cerr << "decode error: "
+                      << e.what()
+                      << std::endl;
+            return value_type{};
+        }
+    }
+
+    static value_type decode(std::string const& s, std::false_type) {
         try { 
             auto j = nlohmann::json::parse(s);
             if (j.is_null()) {
@@ -151,7 +180,7 @@ public:
         return available();
     }
 public:
-    value_type value() const {
+    value_type const& value() const noexcept {
         return value_;
     }
     properties& value(value_type const& value) {
@@ -180,6 +209,13 @@ public:
     static properties deserialize(std::string const& bytes) noexcept {
         return properties{codec_type::decode(bytes)};
     }
+public:
+    static std::string to_msgpack(properties const& prop) noexcept {
+        return codec_type::encode_msgpack(prop.value());
+    }
+    static properties from_msgpack(std::string const& bytes) noexcept {
+        return properties{codec_type::decode_msgpack(bytes)};
+    }
 public:
     static properties from_json(::nlohmann::json const& j) noexcept {
         return properties{codec_type::from_json(j)};
@@ -235,34 +271,6 @@ struct filed {
 template<typename T, typename F>
 using field_pointer_t = typename filed<T, F>::pointer_type;
 
-template<typename T>
-struct from_json_predicate {
-    from_json_predicate(T& obj, nlohmann::json const& j)
-        : obj_(obj)
-        , j_(j) {
-        // EMPTY
-    }
-    template<std::size_t I, typename E>
-    bool apply(E& element) {
-        try {
-            using field_type = typename E::type;
-            auto const& field_key = element.name;
-            auto& field_variable = (obj_.*(element.pointer));
-            field_variable = j_.at(field_key). template get<field_type>();
-            return true;
-        } catch (std::exception const& e) {
-            std::cerr << "from_json_predicate error: "
-                        << e.what()
-                        << std::endl;
-            return false;
-        }
-        return false;
-    }
-private:
-    T& obj_;
-    nlohmann::json const& j_;
-};
-
 template<typename T>
 struct to_json_predicate {
     explicit to_json_predicate(nlohmann::json& j, T const& obj)
@@ -320,9 +328,14 @@ static properties<K, Ts ...> deserialize(std::string const& s) {
 template< typename T
         , typename = std::enable_if_t<std::is_base_of<base, T>::value>>
 static void from_json(::nlohmann::json const& j, T& obj) {
-    auto const meta = T::meta();
-    using meta_type = decltype(meta);
-    ::zbb::util::static_iterate(meta, from_json_predicate<T>{obj, j});
+    try {
+        auto complete = false;
+        json_stream<meta_fields<T>>::from_json(j, obj, complete);
+    } catch (std::exception const& e) {
+        std::cerr << "from_json error: "
+                  << e.what()
+                  << std::endl;
+    }
 }
 
 template< typename T
@@ -336,21 +349,22 @@ static void to_json(::nlohmann::json& j, T const& obj) {
 template< typename T
         , typename = std::enable_if_t<std::is_base_of<base, T>::value>>
 static std::string serialize(T const& obj) {
-    ::nlohmann::json j;
-    to_json(j, obj);
-    if (j.is_null()) {
-        return std::string{};
+    return json_stream<meta_fields<T>>::encode(obj, properties_indent);
+}
+
+// bools, numbers and strings only, parsed by SAX straight into the fields
+template<typename T>
+static T deserialize(std::string const& s, std::true_type) {
+    T obj;
+    auto complete = false;
+    if (!json_stream<meta_fields<T>>::decode(s, obj, complete)) {
+        return T{};
     }
-#if ZBB_CONFIG_PROPERTIES_FORMAT_PRETTY
-    return j.dump(4);
-#else
-    return j.dump();
-#endif
+    return obj;
 }
 
-template< typename T
-        , typename = std::enable_if_t<std::is_base_of<base, T>::value>>
-static T deserialize(std::string const& s) {
+template<typename T>
+static T deserialize(std::string const& s, std::false_type) {
     try { 
         auto j = nlohmann::json::parse(s);
         if (j.is_null()) {
@@ -367,6 +381,15 @@ static T deserialize(std::string const& s) {
     }
 }
 
+template< typename T
+        , typename = std::enable_if_t<std::is_base_of<base, T>::value>>
+static T deserialize(std::string const& s) {
+    using stream_type = json_stream<meta_fields<T>>;
+    return deserialize<T>(s, std::integral_constant< bool
+                                                   , stream_type::supported
+                                                   >{});
+}
+
 ZBB_CONFIG_END
 
 
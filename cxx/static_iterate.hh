@@ -9,41 +9,19 @@
 #define ZBB_UTIL_STATIC_ITERATE_HH
 
 
+#include <cstddef>
+#include <tuple>
 #include <utility>
 #include "./ns.hh"
 
 
 ZBB_UTIL_DETAIL_BEGIN
 
-template<typename T, typename P, size_t I = std::tuple_size<T>::value>
-struct static_iterator_impl {
-    static bool iterate(T& t, P predicate) {
-        static auto const index = std::tuple_size<T>::value - I;
-        if (!predicate. template apply<index>(std::get<index>(t))) {
-            return false;
-        }
-        return static_iterator_impl<T, P, I - 1>::iterate(t, predicate);
-    };
-    static bool iterate(T const& t, P predicate) {
-        static auto const index = std::tuple_size<T>::value - I;
-        if (!predicate. template apply<index>(std::get<index>(t))) {
-            return false;
-        }
-        return static_iterator_impl<T, P, I - 1>::iterate(t, predicate);
-    };
-};
-
-template<typename T, typename P>
-struct static_iterator_impl<T, P, 1> {
-    static bool iterate(T& t, P predicate) {
-        static auto const index = std::tuple_size<T>::value - 1;
-        return predicate. template apply<index>(std::get<index>(t));
-    }
-    static bool iterate(T const& t, P predicate) {
-        static auto const index = std::tuple_size<T>::value - 1;
-        return predicate. template apply<index>(std::get<index>(t));
-    }
-};
+// apply<0>, apply<1>, ... as one && fold, stops at the first false
+template<typename T, typename P, std::size_t ... Is>
+inline bool static_iterate(T& t, P& predicate, std::index_sequence<Is ...>) {
+    return (true && ... && predicate. template apply<Is>(std::get<Is>(t)));
+}
 
 ZBB_UTIL_DETAIL_END
 
@@ -51,12 +29,14 @@ ZBB_UTIL_BEGIN
 
 template<typename T, typename P>
 static bool static_iterate(T& t, P predicate) {
-    return detail::static_iterator_impl<T, P>::iterate(t, predicate);
+    using indices = std::make_index_sequence<std::tuple_size<T>::value>;
+    return detail::static_iterate(t, predicate, indices{});
 };
 
 template<typename T, typename P>
-static bool static_iterate(T const& t, P const predicate) {
-    return detail::static_iterator_impl<T, P>::iterate(t, predicate);
+static bool static_iterate(T const& t, P predicate) {
+    using indices = std::make_index_sequence<std::tuple_size<T>::value>;
+    return detail::static_iterate(t, predicate, indices{});
 };
 
 ZBB_UTIL_END
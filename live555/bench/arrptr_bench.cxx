@@ -0,0 +1,101 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "./bench.hxx"
+#include "../test/arrptr.hxx"
+#include "../test/frame.hxx"
+
+
+//
+// - Allocation cost of the buffers frames live in
+//    - arrptr::make() against a bare new[] and a std::vector, zeroed and not,
+//      at sizes from an AAC packet to an IDR picture.
+//    - arrptr::pooled() takes its block from buffer_pool, copies of it only
+//      touch the refcount inside the block.
+//    - frame::copy() is what every pushed std::string goes through.
+//    - Buffers are held in batches so the allocator cannot hand the same
+//      block back every time.
+//
+namespace {
+    auto constexpr batch = std::size_t{256};
+}
+
+int main() {
+    auto const runs = 5u;
+    std::size_t const sizes[] = {256, 4 * 1024, 64 * 1024, 512 * 1024};
+    std::vector<arrptr<char>> held(batch);
+    std::vector<std::unique_ptr<char[]>> raw(batch);
+    std::vector<std::vector<char>> vectors(batch);
+    std::vector<frame> frames(batch);
+    for (auto const size : sizes) {
+        std::cout << "-- " << size << " bytes" << std::endl;
+        std::string const bytes(size, 'x');
+        auto const rounds = std::size_t{size < 64 * 1024 ? 200u : 20u};
+        auto ns = bench::best(runs, rounds * batch, [&]() {
+            for (std::size_t r = 0; r < rounds; ++r) {
+                for (auto& h : held) {
+                    h = arrptr<char>::make(size, false);
+                }
+            }
+        });
+        bench::report("arrptr::make", ns);
+        ns = bench::best(runs, rounds * batch, [&]() {
+            for (std::size_t r = 0; r < rounds; ++r) {
+                for (auto& h : held) {
+                    h = arrptr<char>::make(size, true);
+                }
+            }
+        });
+        bench::report("arrptr::make, zeroed", ns);
+        ns = bench::best(runs, rounds * batch, [&]() {
+            for (std::size_t r = 0; r < rounds; ++r) {
+                for (auto& h : held) {
+                    h = arrptr<char>::pooled(size);
+                }
+            }
+        });
+        bench::report("arrptr::pooled", ns);
+        ns = bench::best(runs, rounds * batch, [&]() {
+            for (std::size_t r = 0; r < rounds; ++r) {
+                for (auto& h : held) {
+                    auto const copy = h;
+                    bench::keep(copy.size());
+                }
+            }
+        });
+        bench::report("arrptr copy, pooled", ns);
+        ns = bench::best(runs, rounds * batch, [&]() {
+            for (std::size_t r = 0; r < rounds; ++r) {
+                for (auto& p : raw) {
+                    p.reset(new char[size]);
+                }
+            }
+        });
+        bench::report("new char[]", ns);
+        ns = bench::best(runs, rounds * batch, [&]() {
+            for (std::size_t r = 0; r < rounds; ++r) {
+                for (auto& v : vectors) {
+                    v = std::vector<char>(size);
+                }
+            }
+        });
+        bench::report("std::vector<char>", ns);
+        ns = bench::best(runs, rounds * batch, [&]() {
+            for (std::size_t r = 0; r < rounds; ++r) {
+                for (auto& f : frames) {
+                    f = frame::copy(bytes);
+                }
+            }
+        });
+        bench::report("frame::copy", ns, size);
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef BENCH_HXX
+#define BENCH_HXX
+
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+
+//
+// - What every benchmark here shares
+//    - best() runs a round a few times and keeps the fastest, the one least
+//      disturbed by the rest of the machine.
+//    - keep() makes a result observable so the optimizer cannot drop the
+//      work that produced it.
+//
+namespace bench {
+    using clock = std::chrono::steady_clock;
+
+    template<typename T>
+    inline void keep(T const& v) {
+        static T volatile sink;
+        sink = v;
+        static_cast<void>(sink);
+    }
+
+    // nanoseconds per operation of the fastest of runs rounds, each round
+    // being one call of f() doing ops operations
+    template<typename F>
+    double best(unsigned runs, std::uint64_t ops, F f) {
+        auto fastest = std::numeric_limits<double>::max();
+        for (unsigned r = 0; r < runs; ++r) {
+            auto const begin = clock::now();
+            f();
+            auto const end = clock::now();
+            auto const ns = std::chrono::duration<double, std::nano>
+                                    (end - begin).count();
+            fastest = std::min(fastest, ns / static_cast<double>(ops));
+        }
+        return fastest;
+    }
+
+    // bytes per operation turn into MiB/s, 0 prints the time only
+    inline void report( char const* name
+                      , double ns
+                      , std::uint64_t bytes = 0) {
+        std::cout << std::left << std::setw(36) << name
+                  << std::right << std::setw(12) << std::fixed
+                  << std::setprecision(2) << ns << " ns/op";
+        if (0 != bytes) {
+            auto const mib = bytes / ns * 1e9 / (1024 * 1024);
+            std::cout << std::setw(12) << mib << " MiB/s";
+        }
+        std::cout << std::endl;
+    }
+} // bench
+
+
+#endif // BENCH_HXX
@@ -0,0 +1,380 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <liveMedia.hh>
+#include <BasicUsageEnvironment.hh>
+#include "../test/histogram.hxx"
+#include "../test/metrics.hxx"
+#include "../test/stream.hxx"
+
+
+//
+// - Headless RTSP load generator
+//    - Starts streams in process, each fed by its own file producers
+//      (test.h264 and test.aac from the working directory), then plays every
+//      stream from clients over localhost, all on one client event loop.
+//    - Reports throughput, frame and packet loss, the server's ingest to
+//      hand-off latency, the client's capture to arrival latency (once RTCP
+//      synchronized the clocks) and the CPU the server side took per stream.
+//        loadgen [--streams M] [--clients N] [--seconds S] [--port P]
+//                [--tcp] [--json file]
+//
+namespace {
+    struct options {
+        unsigned streams = 1;
+        unsigned clients = 10;
+        unsigned seconds = 30;
+        std::uint16_t port = 8854;
+        bool tcp = false;
+        std::string json;
+    };
+
+    // what all clients received of one medium
+    struct tally {
+        std::uint64_t frames = 0;
+        std::uint64_t bytes = 0;
+        std::uint64_t truncated = 0;
+        std::uint64_t packets = 0;
+        std::uint64_t expected = 0;
+        histogram latency;
+    };
+
+    struct totals {
+        tally audio;
+        tally video;
+        unsigned playing = 0;
+        unsigned failed = 0;
+    };
+
+    double cpu_seconds(int who) {
+        struct rusage usage;
+        if (0 != getrusage(who, &usage)) {
+            return 0;
+        }
+        auto const seconds = [](struct timeval const& tv) {
+            return tv.tv_sec + tv.tv_usec / 1e6;
+        };
+        return seconds(usage.ru_utime) + seconds(usage.ru_stime);
+    }
+
+    std::uint64_t micros(struct timeval const& tv) {
+        return std::uint64_t(tv.tv_sec) * 1000000 + tv.tv_usec;
+    }
+}
+
+
+class counting_sink final: public MediaSink {
+public:
+    static auto constexpr buffer_size = 1024u * 1024u;
+public:
+    counting_sink( UsageEnvironment& env
+                 , MediaSubsession& subsession
+                 , tally& t)
+        : MediaSink(env)
+        , subsession_(subsession)
+        , tally_(t)
+        , buffer_(new u_int8_t[buffer_size]) {
+        // EMPTY
+    }
+    virtual ~counting_sink() = default;
+private:
+    virtual Boolean continuePlaying() override {
+        if (nullptr == fSource) {
+            return False;
+        }
+        fSource->getNextFrame( buffer_.get()
+                             , buffer_size
+                             , &counting_sink::after_getting
+                             , this
+                             , MediaSink::onSourceClosure
+                             , this);
+        return True;
+    }
+    static void after_getting( void* self
+                             , unsigned size
+                             , unsigned truncated
+                             , struct timeval pts
+                             , unsigned) {
+        auto const sink = static_cast<counting_sink*>(self);
+        sink->count(size, truncated, pts);
+        sink->continuePlaying();
+    }
+    void count(unsigned size, unsigned truncated, struct timeval pts) {
+        ++tally_.frames;
+        tally_.bytes += size;
+        tally_.truncated += truncated;
+        auto const source = subsession_.rtpSource();
+        if (nullptr == source || !source->hasBeenSynchronizedUsingRTCP()) {
+            return;
+        }
+        struct timeval now;
+        gettimeofday(&now, nullptr);
+        auto const at = micros(now);
+        auto const captured = micros(pts);
+        tally_.latency.record(at > captured ? at - captured : 0);
+    }
+private:
+    MediaSubsession& subsession_;
+    tally& tally_;
+    std::unique_ptr<u_int8_t[]> buffer_;
+};
+
+
+class client final: public RTSPClient {
+public:
+    static client* createNew( UsageEnvironment& env
+                            , std::string const& url
+                            , bool tcp
+                            , totals& t) {
+        return new client(env, url, tcp, t);
+    }
+private:
+    client( UsageEnvironment& env
+          , std::string const& url
+          , bool tcp
+          , totals& t)
+        : RTSPClient(env, url.c_str(), 0, "loadgen", 0, -1)
+        , tcp_(tcp)
+        , totals_(t) {
+        sendDescribeCommand(&client::on_describe);
+    }
+public:
+    virtual ~client() {
+        if (nullptr != session_) {
+            MediaSubsessionIterator i(*session_);
+            for (auto s = i.next(); nullptr != s; s = i.next()) {
+                Medium::close(s->sink);
+                s->sink = nullptr;
+            }
+            Medium::close(session_);
+        }
+    }
+public:
+    // packets received and expected by the RTP sources so far
+    void reception() {
+        if (nullptr == session_) {
+            return;
+        }
+        MediaSubsessionIterator i(*session_);
+        for (auto s = i.next(); nullptr != s; s = i.next()) {
+            if (nullptr == s->rtpSource()) {
+                continue;
+            }
+            auto& t = tally_of(*s);
+            RTPReceptionStatsDB::Iterator stats
+                    (s->rtpSource()->receptionStatsDB());
+            for (auto r = stats.next(True); nullptr != r;
+                 r = stats.next(True)) {
+                t.packets += r->totNumPacketsReceived();
+                t.expected += r->totNumPacketsExpected();
+            }
+        }
+    }
+private:
+    static void on_describe(RTSPClient* self, int code, char* result) {
+        std::unique_ptr<char[]> sdp{result};
+        auto const c = static_cast<client*>(self);
+        if (0 != code) {
+            c->fail("DESCRIBE", result);
+            return;
+        }
+        c->session_ = MediaSession::createNew(c->envir(), sdp.get());
+        if (nullptr == c->session_) {
+            c->fail("SDP", c->envir().getResultMsg());
+            return;
+        }
+        c->subsessions_.reset(new MediaSubsessionIterator(*c->session_));
+        c->setup_next();
+    }
+    static void on_setup(RTSPClient* self, int code, char* result) {
+        std::unique_ptr<char[]> guard{result};
+        auto const c = static_cast<client*>(self);
+        if (0 != code) {
+            c->fail("SETUP", result);
+            return;
+        }
+        auto& s = *c->current_;
+        s.sink = new counting_sink(c->envir(), s, c->tally_of(s));
+        s.sink->startPlaying(*s.readSource(), nullptr, nullptr);
+        c->setup_next();
+    }
+    static void on_play(RTSPClient* self, int code, char* result) {
+        std::unique_ptr<char[]> guard{result};
+        auto const c = static_cast<client*>(self);
+        if (0 != code) {
+            c->fail("PLAY", result);
+            return;
+        }
+        ++c->totals_.playing;
+    }
+private:
+    void setup_next() {
+        for (current_ = subsessions_->next(); nullptr != current_;
+             current_ = subsessions_->next()) {
+            if (current_->initiate()) {
+                sendSetupCommand(*current_, &client::on_setup, False, tcp_);
+                return;
+            }
+        }
+        sendPlayCommand(*session_, &client::on_play);
+    }
+    void fail(char const* what, char const* why) {
+        std::cerr << url() << ": " << what << " failed: "
+                  << (nullptr == why ? "" : why) << std::endl;
+        ++totals_.failed;
+    }
+    tally& tally_of(MediaSubsession const& s) {
+        return 0 == strcmp(s.mediumName(), "video") ? totals_.video
+                                                    : totals_.audio;
+    }
+private:
+    bool const tcp_;
+    totals& totals_;
+    MediaSession* session_ = nullptr;
+    std::unique_ptr<MediaSubsessionIterator> subsessions_;
+    MediaSubsession* current_ = nullptr;
+};
+
+
+namespace {
+    options parse(int argc, char* argv[]) {
+        options o;
+        for (auto i = 1; i < argc; ++i) {
+            std::string const arg{argv[i]};
+            auto const next = [&]() -> char const* {
+                return i + 1 < argc ? argv[++i] : "0";
+            };
+            if ("--streams" == arg) {
+                o.streams = std::strtoul(next(), nullptr, 10);
+            } else if ("--clients" == arg) {
+                o.clients = std::strtoul(next(), nullptr, 10);
+            } else if ("--seconds" == arg) {
+                o.seconds = std::strtoul(next(), nullptr, 10);
+            } else if ("--port" == arg) {
+                o.port = static_cast<std::uint16_t>
+                         (std::strtoul(next(), nullptr, 10));
+            } else if ("--tcp" == arg) {
+                o.tcp = true;
+            } else if ("--json" == arg) {
+                o.json = next();
+            } else {
+                std::cerr << "unknown option: " << arg << std::endl;
+            }
+        }
+        return o;
+    }
+
+    void print(char const* name, tally const& t, double seconds) {
+        auto const lost = t.expected > t.packets ? t.expected - t.packets : 0;
+        std::cout << name << ": " << t.frames << " frames, "
+                  << t.bytes * 8 / seconds / 1e6 << " Mbit/s, "
+                  << t.truncated << " bytes truncated, "
+                  << lost << " of " << t.expected << " packets lost"
+                  << std::endl
+                  << "  capture to arrival us: p50 "
+                  << t.latency.percentile(0.5) << ", p99 "
+                  << t.latency.percentile(0.99) << ", max "
+                  << t.latency.max() << " (" << t.latency.count()
+                  << " synchronized frames)" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    auto const o = parse(argc, argv);
+    if (0 == o.streams || 0 == o.seconds) {
+        std::cerr << "nothing to do" << std::endl;
+        return 1;
+    }
+    std::vector<std::unique_ptr<stream>> streams;
+    std::vector<std::string> urls;
+    for (unsigned i = 0; i < o.streams; ++i) {
+        auto const name = "load" + std::to_string(i);
+        auto const port = static_cast<std::uint16_t>(o.port + i);
+        std::unique_ptr<stream> s{new stream{name, port}};
+        if (!s->available() || !s->start(1, 4, 2, 1280, 720, 2000, 25)) {
+            std::cerr << "stream failed on port " << port << std::endl;
+            return 1;
+        }
+        urls.push_back( "rtsp://127.0.0.1:" + std::to_string(port)
+                      + "/" + name);
+        streams.push_back(std::move(s));
+    }
+
+    totals t;
+    auto client_cpu = 0.0;
+    auto const cpu_before = cpu_seconds(RUSAGE_SELF);
+    auto const begin = std::chrono::steady_clock::now();
+    std::thread clients{[&]() {
+        auto const cpu = cpu_seconds(RUSAGE_THREAD);
+        auto const scheduler = BasicTaskScheduler::createNew();
+        auto const env = BasicUsageEnvironment::createNew(*scheduler);
+        std::vector<client*> all;
+        for (unsigned i = 0; i < o.clients; ++i) {
+            all.push_back(client::createNew( *env
+                                           , urls[i % urls.size()]
+                                           , o.tcp
+                                           , t));
+        }
+        char volatile done = 0;
+        auto const stop = [](void* flag) {
+            *static_cast<char volatile*>(flag) = 1;
+        };
+        scheduler->scheduleDelayedTask( std::int64_t{o.seconds} * 1000000
+                                      , stop
+                                      , const_cast<char*>(&done));
+        scheduler->doEventLoop(&done);
+        for (auto c : all) {
+            c->reception();
+            Medium::close(c);
+        }
+        client_cpu = cpu_seconds(RUSAGE_THREAD) - cpu;
+        env->reclaim();
+        delete scheduler;
+    }};
+    clients.join();
+    auto const seconds = std::chrono::duration<double>
+                                 (std::chrono::steady_clock::now() - begin)
+                                 .count();
+    auto const server_cpu = cpu_seconds(RUSAGE_SELF) - cpu_before
+                          - client_cpu;
+
+    std::cout << o.streams << " streams, " << o.clients << " clients ("
+              << t.playing << " playing, " << t.failed << " failed) over "
+              << (o.tcp ? "TCP" : "UDP") << " for " << seconds << " s"
+              << std::endl;
+    print("video", t.video, seconds);
+    print("audio", t.audio, seconds);
+    for (std::size_t i = 0; i < streams.size(); ++i) {
+        auto& h = streams[i]->h264_latency();
+        std::cout << urls[i] << " ingest to hand-off us: p50 "
+                  << h.percentile(0.5) << ", p99 " << h.percentile(0.99)
+                  << ", max " << h.max() << std::endl;
+    }
+    std::cout << "server cpu: " << server_cpu / seconds * 100
+              << "% of a core, " << server_cpu / seconds * 100 / o.streams
+              << "% per stream" << std::endl
+              << "client cpu: " << client_cpu / seconds * 100
+              << "% of a core" << std::endl;
+    if (!o.json.empty() && !metrics::shared().save(o.json)) {
+        std::cerr << "metrics not saved: " << o.json << std::endl;
+    }
+    for (auto& s : streams) {
+        s->end();
+    }
+    return 0;
+}
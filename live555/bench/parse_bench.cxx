@@ -0,0 +1,263 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "./bench.hxx"
+#include "../test/aac_utils.hxx"
+#include "../test/adts.hxx"
+#include "../test/h264_utils.hxx"
+#include "../test/mapped_file.hxx"
+
+
+//
+// - Bitstream parsing: start code search and NAL scanning over an Annex-B
+//   stream, ADTS header decoding over an ADTS stream
+//    - Both streams are synthetic unless files are given:
+//        parse_bench [file.h264 [file.aac]]
+//    - adts::parse() is also set against the hand-written shifts the sources
+//      used before, given the same checks so both accept the same headers:
+//      on a stream in sync and at every offset of noise, as on resync.
+//
+namespace {
+    // slices of random payload, no accidental start codes, an IDR with
+    // SPS / PPS every 50 pictures
+    std::string make_h264(std::size_t pictures) {
+        std::mt19937 random{42};
+        std::string s;
+        for (std::size_t i = 0; i < pictures; ++i) {
+            auto const key = 0 == i % 50;
+            if (key) {
+                s += std::string("\0\0\0\x01\x67\x42\x00\x1f", 8);
+                s += std::string("\0\0\0\x01\x68\xce\x3c\x80", 8);
+            }
+            s += std::string("\0\0\0\x01", 4);
+            s += key ? '\x65' : '\x41';
+            auto const size = key ? 60000 + random() % 20000
+                                  : 2000 + random() % 8000;
+            for (std::size_t j = 0; j < size; ++j) {
+                s += static_cast<char>(2 + random() % 254);
+            }
+        }
+        return s;
+    }
+
+    std::string make_aac(std::size_t packets) {
+        std::mt19937 random{7};
+        std::string s;
+        for (std::size_t i = 0; i < packets; ++i) {
+            auto const len = 200 + random() % 500;
+            std::string p(len, '\x5a');
+            p[0] = '\xff';
+            p[1] = '\xf1';
+            p[2] = static_cast<char>((1 << 6) | (4 << 2));
+            p[3] = static_cast<char>((2 << 6) | ((len >> 11) & 0x03));
+            p[4] = static_cast<char>((len >> 3) & 0xff);
+            p[5] = static_cast<char>(((len & 0x07) << 5) | 0x1f);
+            p[6] = '\xfc';
+            s += p;
+        }
+        return s;
+    }
+
+    // the old shifts on unsigned bytes, plus the layer and minimum length
+    // checks adts::header::valid() makes
+    bool shifts(char const* bytes, std::size_t size, std::size_t& payload) {
+        if (size < adts::header_size || !aac_utils::has_syncword(bytes, size)) {
+            return false;
+        }
+        auto const b = reinterpret_cast<unsigned char const*>(bytes);
+        auto const header = (b[1] & 0x01) ? std::size_t{7} : std::size_t{9};
+        std::size_t const len = ((b[3] & 0x03) << 11)
+                              | (b[4] << 3)
+                              | ((b[5] & 0xe0) >> 5);
+        if (0 != (b[1] & 0x06) || len < header || len > size) {
+            return false;
+        }
+        payload = len - header;
+        return true;
+    }
+
+    bool parse(char const* bytes, std::size_t size, std::size_t& payload) {
+        auto const h = adts::parse(bytes, size);
+        if (!h.valid() || h.frame_length() > size) {
+            return false;
+        }
+        payload = h.payload_size();
+        return true;
+    }
+
+    // about half the offsets, at random, look like a syncword
+    std::string make_noise(std::size_t size) {
+        std::mt19937 random{7};
+        std::string noise(size, '\0');
+        for (auto& c : noise) {
+            c = static_cast<char>(random());
+        }
+        for (std::size_t i = 0; i + 1 < noise.size(); i += 2) {
+            if (0 != (random() & 1)) {
+                noise[i] = '\xff';
+                noise[i + 1] = static_cast<char>(0xf0 | (random() & 0x0f));
+            }
+        }
+        return noise;
+    }
+
+    // payload bytes of the packets at sizes, one after the other
+    template<typename F>
+    std::uint64_t in_sync( std::string const& aac
+                         , std::vector<std::size_t> const& sizes
+                         , F f) {
+        std::uint64_t sum = 0;
+        std::size_t offset = 0;
+        for (auto const size : sizes) {
+            std::size_t payload = 0;
+            if (f(aac.data() + offset, size, payload)) {
+                sum += payload;
+            }
+            offset += size;
+        }
+        return sum;
+    }
+
+    // headers accepted at every offset
+    template<typename F>
+    std::uint64_t resync(std::string const& noise, F f) {
+        std::uint64_t hits = 0;
+        for (std::size_t i = 0; i + adts::header_size <= noise.size(); ++i) {
+            std::size_t payload = 0;
+            hits += f(noise.data() + i, noise.size() - i, payload);
+        }
+        return hits;
+    }
+
+    std::string load(char const* path) {
+        auto const file = mapped_file::map(path);
+        return file ? std::string{file.ptr(), file.size()} : std::string{};
+    }
+}
+
+int main(int argc, char* argv[]) {
+    auto const h264 = argc > 1 ? load(argv[1]) : make_h264(500);
+    auto const aac = argc > 2 ? load(argv[2]) : make_aac(20000);
+    if (h264.empty() || aac.empty()) {
+        std::cerr << "nothing to parse" << std::endl;
+        return 1;
+    }
+    auto const runs = 5u;
+
+    std::size_t found = 0;
+    auto ns = bench::best(runs, 1, [&]() {
+        found = 0;
+        for (std::size_t i = 0; i < h264.size();) {
+            auto const p = i + h264_utils::find_start_code( h264.data() + i
+                                                         , h264.size() - i);
+            if (p >= h264.size()) {
+                break;
+            }
+            ++found;
+            i = p + 3;
+        }
+        bench::keep(found);
+    });
+    bench::report("h264_utils::find_start_code", ns, h264.size());
+
+    std::vector<h264_utils::nal> nals;
+    ns = bench::best(runs, 1, [&]() {
+        nals.clear();
+        h264_utils::scan(h264.data(), h264.size(), nals);
+        bench::keep(nals.size());
+    });
+    bench::report("h264_utils::scan", ns, h264.size());
+
+    ns = bench::best(runs, 1, [&]() {
+        bench::keep(h264_utils::nal_types(h264.data(), h264.size()));
+    });
+    bench::report("h264_utils::nal_types", ns, h264.size());
+    std::cout << "  " << nals.size() << " NAL units, "
+              << h264.size() << " bytes" << std::endl;
+
+    // walk the ADTS stream header by header, as the producer does
+    std::size_t packets = 0;
+    ns = bench::best(runs, 1, [&]() {
+        packets = 0;
+        for (std::size_t i = 0; i + adts::header_size <= aac.size();) {
+            // the length sits in the fourth header byte and after
+            auto const len = aac_utils::packet_len(aac.data() + i + 3
+                                                  , aac.size() - i - 3);
+            if (0 == len) {
+                break;
+            }
+            ++packets;
+            i += len;
+        }
+        bench::keep(packets);
+    });
+    bench::report("aac_utils::packet_len walk", ns / packets);
+
+    ns = bench::best(runs, 1, [&]() {
+        std::uint64_t samples = 0;
+        for (std::size_t i = 0; i + adts::header_size <= aac.size();) {
+            auto const h = adts::parse(aac.data() + i, aac.size() - i);
+            if (!h.valid()) {
+                break;
+            }
+            samples += h.samples();
+            i += h.frame_length();
+        }
+        bench::keep(samples);
+    });
+    bench::report("adts::parse walk", ns / packets);
+    std::cout << "  " << packets << " ADTS packets, "
+              << aac.size() << " bytes" << std::endl;
+
+    std::vector<std::size_t> sizes;
+    for (std::size_t i = 0; i + adts::header_size <= aac.size();) {
+        auto const h = adts::parse(aac.data() + i, aac.size() - i);
+        if (!h.valid()) {
+            break;
+        }
+        sizes.push_back(h.frame_length());
+        i += h.frame_length();
+    }
+    std::uint64_t shifts_sum = 0;
+    std::uint64_t parse_sum = 0;
+    auto const shifts_ns = bench::best(runs, sizes.size(), [&]() {
+        shifts_sum = in_sync(aac, sizes, shifts);
+        bench::keep(shifts_sum);
+    });
+    auto const parse_ns = bench::best(runs, sizes.size(), [&]() {
+        parse_sum = in_sync(aac, sizes, parse);
+        bench::keep(parse_sum);
+    });
+    bench::report("ADTS in sync, shifts", shifts_ns);
+    bench::report("ADTS in sync, adts::parse", parse_ns);
+
+    auto const noise = make_noise(64 * 1024);
+    std::uint64_t shifts_hits = 0;
+    std::uint64_t parse_hits = 0;
+    auto const shifts_scan = bench::best(runs, noise.size(), [&]() {
+        shifts_hits = resync(noise, shifts);
+        bench::keep(shifts_hits);
+    });
+    auto const parse_scan = bench::best(runs, noise.size(), [&]() {
+        parse_hits = resync(noise, parse);
+        bench::keep(parse_hits);
+    });
+    bench::report("ADTS resync, shifts", shifts_scan);
+    bench::report("ADTS resync, adts::parse", parse_scan);
+    std::cout << "  " << parse_hits << " headers in "
+              << noise.size() << " bytes of noise" << std::endl;
+    if (shifts_sum != parse_sum || shifts_hits != parse_hits) {
+        std::cerr << "ADTS decoders disagree" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,155 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "./bench.hxx"
+#include "../../cxx/properties.hh"
+
+
+//
+// - properties serialize / deserialize round trips
+//    - A stream's configuration, the kind of record the server keeps per
+//      channel: a handful of strings and numbers.
+//    - A client's counters, all trivially copyable, which to_msgpack()
+//      copies with memcpy.
+//    - ../cxx/ needs ns.hh and util/ from outside this tree, CMake builds
+//      this only with ZBB_CONFIG_DIR pointing at them.
+//
+namespace {
+    struct keys {
+        // constexpr, so field_lookup hashes them at compile time
+        template<std::size_t I>
+        static constexpr char const* get() {
+            constexpr char const* names[] = { "name"
+                                            , "url"
+                                            , "port"
+                                            , "fps"
+                                            , "bitrate"
+                                            , "width"
+                                            , "height"
+                                            , "sps"
+                                            , "pps"
+                                            , "gain"};
+            return names[I];
+        }
+    };
+
+    using channel = ::zbb::config::properties< keys
+                                             , std::string
+                                             , std::string
+                                             , std::uint16_t
+                                             , unsigned
+                                             , unsigned
+                                             , unsigned
+                                             , unsigned
+                                             , std::string
+                                             , std::string
+                                             , double>;
+
+    // per client counters, all trivially copyable
+    using sample = ::zbb::config::properties< keys
+                                            , std::uint64_t
+                                            , std::uint64_t
+                                            , std::uint64_t
+                                            , std::uint32_t
+                                            , std::uint32_t
+                                            , std::uint16_t
+                                            , bool
+                                            , double>;
+}
+
+int main() {
+    auto const runs = 5u;
+    auto const rounds = std::size_t{20000};
+    channel const c{ std::string{"mirror"}
+                   , std::string{"rtsp://127.0.0.1:8854/mirror"}
+                   , std::uint16_t{8854}
+                   , 25u
+                   , 2000u
+                   , 1920u
+                   , 1080u
+                   , std::string{"Z0IAH5WoFAFuQA=="}
+                   , std::string{"aM48gA=="}
+                   , 0.75};
+    auto const bytes = channel::serialize(c);
+    auto ns = bench::best(runs, rounds, [&]() {
+        for (std::size_t i = 0; i < rounds; ++i) {
+            bench::keep(channel::serialize(c).size());
+        }
+    });
+    bench::report("properties::serialize", ns, bytes.size());
+    ns = bench::best(runs, rounds, [&]() {
+        for (std::size_t i = 0; i < rounds; ++i) {
+            bench::keep(channel::deserialize(bytes).get<2>());
+        }
+    });
+    bench::report("properties::deserialize", ns, bytes.size());
+    // the nlohmann::json tree both used to go through
+    ns = bench::best(runs, rounds, [&]() {
+        for (std::size_t i = 0; i < rounds; ++i) {
+            bench::keep(channel::to_json(c).dump(4).size());
+        }
+    });
+    bench::report("to_json + dump", ns, bytes.size());
+    ns = bench::best(runs, rounds, [&]() {
+        for (std::size_t i = 0; i < rounds; ++i) {
+            auto const j = nlohmann::json::parse(bytes);
+            bench::keep(channel::from_json(j).get<2>());
+        }
+    });
+    bench::report("parse + from_json", ns, bytes.size());
+    std::cout << "  " << bytes.size() << " bytes encoded" << std::endl;
+
+    auto const packed = channel::to_msgpack(c);
+    ns = bench::best(runs, rounds, [&]() {
+        for (std::size_t i = 0; i < rounds; ++i) {
+            bench::keep(channel::to_msgpack(c).size());
+        }
+    });
+    bench::report("properties::to_msgpack", ns, packed.size());
+    ns = bench::best(runs, rounds, [&]() {
+        for (std::size_t i = 0; i < rounds; ++i) {
+            bench::keep(channel::from_msgpack(packed).get<2>());
+        }
+    });
+    bench::report("properties::from_msgpack", ns, packed.size());
+    std::cout << "  " << packed.size() << " bytes packed" << std::endl;
+
+    sample const s{ std::uint64_t{123456789}
+                  , std::uint64_t{987654321}
+                  , std::uint64_t{42}
+                  , std::uint32_t{1400}
+                  , std::uint32_t{7}
+                  , std::uint16_t{8854}
+                  , true
+                  , 0.125};
+    auto const text = sample::serialize(s);
+    auto const raw = sample::to_msgpack(s);
+    ns = bench::best(runs, rounds, [&]() {
+        for (std::size_t i = 0; i < rounds; ++i) {
+            bench::keep(sample::serialize(s).size());
+        }
+    });
+    bench::report("counters serialize", ns, text.size());
+    ns = bench::best(runs, rounds, [&]() {
+        for (std::size_t i = 0; i < rounds; ++i) {
+            bench::keep(sample::to_msgpack(s).size());
+        }
+    });
+    bench::report("counters to_msgpack (memcpy)", ns, raw.size());
+    ns = bench::best(runs, rounds, [&]() {
+        for (std::size_t i = 0; i < rounds; ++i) {
+            bench::keep(sample::from_msgpack(raw).get<0>());
+        }
+    });
+    bench::report("counters from_msgpack (memcpy)", ns, raw.size());
+    std::cout << "  " << text.size() << " bytes as JSON, " << raw.size()
+              << " packed" << std::endl;
+    return 0;
+}
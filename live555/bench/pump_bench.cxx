@@ -0,0 +1,135 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "./bench.hxx"
+#include "../test/aac_pump.hxx"
+#include "../test/h264_pump.hxx"
+
+
+//
+// - Producer cost of the pumps with 0 .. N readers draining them
+//    - Every reader is a thread polling its own cursor, the way event loops
+//      do once woken; the producer never waits for them.
+//    - Timing starts once every reader has subscribed, and the rings hold
+//      the whole run, so each reader gets every frame however the threads
+//      are scheduled; the readers drain what is left after the clock stops.
+//    - Reported per published frame, together with what the readers got
+//      out of what was published and what they had to skip.
+//        pump_bench [max readers]
+//
+namespace {
+    // seconds of media produced per run, the rings hold one more
+    auto constexpr rounds = std::size_t{20};
+    auto constexpr buffer_ms = static_cast<unsigned>((rounds + 1) * 1000);
+
+    struct result {
+        double ns;
+        std::uint64_t read;
+        std::uint64_t expected;
+        std::uint64_t skipped;
+    };
+
+    template<typename Pump>
+    result drive( Pump& pump
+                , std::vector<frame> const& frames
+                , std::size_t readers) {
+        std::atomic<bool> running{true};
+        std::atomic<std::size_t> ready{0};
+        std::atomic<std::uint64_t> read{0};
+        std::atomic<std::uint64_t> skipped{0};
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < readers; ++i) {
+            threads.emplace_back([&]() {
+                auto r = pump.subscribe();
+                ready.fetch_add(1);
+                std::uint64_t n = 0;
+                frame f;
+                for (;running.load(std::memory_order_relaxed);) {
+                    if (r.read(f)) {
+                        ++n;
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+                for (;r.read(f);) {
+                    ++n;
+                }
+                read.fetch_add(n);
+                skipped.fetch_add(r.skipped());
+            });
+        }
+        for (;ready.load() < readers;) {
+            std::this_thread::yield();
+        }
+        auto const published = pump.stats().frames_in();
+        auto const ns = bench::best(1, rounds * frames.size(), [&]() {
+            for (std::size_t r = 0; r < rounds; ++r) {
+                for (auto const& f : frames) {
+                    pump.produce(f);
+                }
+            }
+        });
+        running = false;
+        for (auto& t : threads) {
+            t.join();
+        }
+        auto const expected = readers * (pump.stats().frames_in()
+                                         - published);
+        return result{ns, read.load(), expected, skipped.load()};
+    }
+
+    void print(char const* name, std::size_t readers, result const& r) {
+        std::string const label = std::string{name} + ", "
+                                + std::to_string(readers) + " readers";
+        bench::report(label.c_str(), r.ns);
+        std::cout << "  read " << r.read << " of " << r.expected
+                  << ", skipped " << r.skipped << std::endl;
+    }
+
+    // one second of 25 fps video, single-slice pictures behind an AUD and
+    // a GOP short enough for a skipping reader to find a keyframe in the ring
+    std::vector<frame> make_h264() {
+        std::vector<frame> frames;
+        for (auto i = 0; i < 25; ++i) {
+            auto const key = 0 == i % 5;
+            std::string au("\0\0\0\x01\x09\xf0\0\0\0\x01", 10);
+            au += key ? '\x65' : '\x41';
+            au += std::string(key ? 60000 : 6000, '\x5a');
+            frames.push_back(frame::copy(au));
+        }
+        return frames;
+    }
+
+    // one second of 44.1 kHz audio
+    std::vector<frame> make_aac() {
+        std::vector<frame> frames;
+        for (auto i = 0; i < 43; ++i) {
+            frames.push_back(frame::copy(std::string(400, '\x5a')));
+        }
+        return frames;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    auto const max_readers = argc > 1 ? std::stoul(argv[1]) : 16ul;
+    auto const h264 = make_h264();
+    auto const aac = make_aac();
+    for (std::size_t n = 0; n <= max_readers; n = (0 == n) ? 1 : n * 4) {
+        h264_pump hp{25, buffer_ms};
+        print("h264_pump::produce", n, drive(hp, h264, n));
+        aac_pump ap{44100, buffer_ms};
+        print("aac_pump::produce", n, drive(ap, aac, n));
+    }
+    return 0;
+}
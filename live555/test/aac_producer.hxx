@@ -9,84 +9,166 @@
 #define AAC_PRODUCER_HXX
 
 
-#include <atomic>
-#include <mutex>
+#include <cstdint>
+#include <cstring>
 #include <memory>
-#include <condition_variable>
-#include <queue>
-#include <fstream>
+#include <string>
+#include <iostream>
+#include <vector>
+#include "./arrptr.hxx"
+#include "./frame.hxx"
+#include "./mapped_file.hxx"
 #include "./aac_utils.hxx"
+#include "./adts.hxx"
 #include "./aac_pump.hxx"
+#include "./pacer.hxx"
 
 
 class aac_producer {
 public:
-    aac_producer(std::shared_ptr<aac_pump> const& pump)
-        : pump_(pump) {
-        std::ifstream ifs{"test.aac", std::ios::binary};
-        if (!ifs) {
+    aac_producer( std::shared_ptr<aac_pump> const& pump
+                , std::string const& path = "test.aac"
+                , pacer::time_point start = pacer::clock::now()
+                , pacer& p = pacer::shared())
+        : pump_(pump)
+        , file_(mapped_file::map(path))
+        , pacer_(p) {
+        if (!file_) {
             return;
         }
-        ifs.seekg(0, std::ios::end);
-        auto const size = static_cast<std::size_t>(ifs.tellg());
-        ifs.seekg(0, std::ios::beg);
-
-        std::unique_ptr<char[]> buffer{new char[size]};
-        ifs.read(buffer.get(), size);
-
-        std::size_t i = 0;
-        for (;;) {
-            if (i > size - 7) {
-                break;
-            }
-            if (!aac_utils::has_syncword(&buffer[i], 2)) {
-                break;
+        // the first packet tells the sampling frequency, one tick per packet
+        frame first;
+        if (!index_next(first)) {
+            return;
+        }
+        next_ = 0;
+        auto const header = adts::parse(first.data(), first.size());
+        auto const frequency = header.sampling_frequency();
+        if (0 == frequency) {
+            std::cerr << "aac_producer: bad sampling frequency" << std::endl;
+            return;
+        }
+        clock_ = pacer_.add( [this]() { return tick(); }
+                           , samples_per_frame
+                           , frequency
+                           , start);
+    }
+    ~aac_producer() {
+        pacer_.remove(clock_);
+    }
+public:
+    pacer::jitter jitter() const {
+        return pacer_.stats(clock_);
+    }
+private:
+    bool tick() {
+        frame packet;
+        if (!next(packet)) {
+            return false;
+        }
+        pump_->produce(packet);
+        return true;
+    }
+    // The first pass scans lazily and records where the packets are, later
+    // passes replay that index. Pages behind the cursor are released.
+    bool next(frame& packet) {
+        if (next_ < index_.size()) {
+            auto const& e = index_[next_++];
+            packet = file_.slice(static_cast<std::size_t>(e.offset), e.size);
+            release(static_cast<std::size_t>(e.offset));
+            return true;
+        }
+        if (!indexed_ && index_next(packet)) {
+            ++next_;
+            release(scanned_);
+            return true;
+        }
+        indexed_ = true;
+        if (index_.empty()) {
+            return false;
+        }
+        next_ = 0;
+        released_ = 0;
+        return next(packet);
+    }
+    bool index_next(frame& packet) {
+        auto const size = file_.size();
+        for (;scanned_ + 7 <= size;) {
+            auto const len = valid_at(scanned_);
+            if (0 == len) {
+                std::cerr << "aac_producer: lost sync at " << scanned_
+                          << std::endl;
+                scanned_ = resync(scanned_ + 1);
+                continue;
             }
-            auto const len = aac_utils::packet_len(&buffer[i + 3], 3);
-            packets_.emplace_back(std::string{&buffer[i], len});
-            i += len;
+            index_.push_back(entry{scanned_, len});
+            packet = file_.slice(scanned_, len);
+            scanned_ += len;
+            return true;
         }
-
-        initialize_thread();
+        scanned_ = size;
+        indexed_ = true;
+        return false;
     }
-    void thread_routine() {
-        if (packets_.empty()) {
-            return;
+    // packet length if a plausible ADTS packet starts at i, 0 otherwise
+    std::uint16_t valid_at(std::size_t i) const {
+        auto const data = file_.data();
+        auto const size = file_.size();
+        if (i >= size) {
+            return 0;
         }
-        auto const size = packets_.size();
-        auto i = std::vector<std::string>::size_type{0};
-        for (;looping_;) {
-            if (size == i) {
-                i = 0;
+        auto const header = adts::parse(data + i, size - i);
+        if (!header.valid() || i + header.frame_length() > size) {
+            return 0;
+        }
+        return static_cast<std::uint16_t>(header.frame_length());
+    }
+    // next offset from i holding a packet that is followed by another
+    // syncword (or the end of the file)
+    std::size_t resync(std::size_t i) const {
+        auto const data = file_.data();
+        auto const size = file_.size();
+        for (;i + 7 <= size;) {
+            auto const p = memchr(data + i, 0xff, size - i);
+            if (nullptr == p) {
+                break;
+            }
+            i = static_cast<std::size_t>(static_cast<char const*>(p) - data);
+            auto const len = valid_at(i);
+            if (0 != len && (i + len == size || 0 != valid_at(i + len))) {
+                return i;
             }
-            pump_->produce(packets_[i++]);
-            std::this_thread::sleep_for(std::chrono::milliseconds{21});
+            ++i;
         }
+        return size;
     }
-    bool initialize_thread() {
-        thread_ = std::thread{&aac_producer::thread_routine, this};
-        try {
-            thread_.detach();
-        } catch (std::exception const& e) {
-            std::cerr << "thread detach failed: "
-                      << e.what()
-                      << std::endl;
-            return false;
+    void release(std::size_t offset) {
+        if (offset < released_ + release_window * 2) {
+            return;
         }
-        return true;
+        auto const to = offset - release_window;
+        mapped_file::release(file_.buffer(), released_, to - released_);
+        released_ = to;
     }
 private:
-    std::atomic_bool looping_{true};
-    std::thread thread_;
-    std::mutex mutex_;
-    std::condition_variable cv_;
-
-    std::atomic_bool finished_{false};
-    std::condition_variable finish_cv_;
-    std::mutex efinish_mutex_;
+    struct entry {
+        std::uint64_t offset;
+        std::uint32_t size;
+    };
+private:
+    static auto constexpr release_window = std::size_t{1024 * 1024};
+    static auto constexpr samples_per_frame = std::uint64_t{1024};
 private:
     std::shared_ptr<aac_pump> pump_;
-    std::vector<std::string> packets_;
+    frame file_;
+    std::vector<entry> index_;
+    std::vector<entry>::size_type next_ = 0;
+    std::size_t scanned_ = 0;
+    std::size_t released_ = 0;
+    bool indexed_ = false;
+private:
+    pacer& pacer_;
+    pacer::id clock_ = 0;
 };
 
 
@@ -9,47 +9,105 @@
 #define AAC_PUMP_HXX
 
 
-#include <mutex>
-#include <condition_variable>
-#include <queue>
-#include <iostream>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "./broadcast_ring.hxx"
+#include "./frame.hxx"
+#include "./histogram.hxx"
+#include "./notifier.hxx"
+#include "./pump_stats.hxx"
+#include "./timeline.hxx"
 
 
 class aac_pump final {
 public:
-    aac_pump(unsigned sampling_frequency, unsigned buffer_ms)
-        : buffer_size_(buffer_size(sampling_frequency, buffer_ms)) {
+    using reader = broadcast_ring<frame>::reader;
+public:
+    aac_pump( unsigned sampling_frequency
+            , unsigned buffer_ms
+            , std::shared_ptr<timeline> const& pts_timeline = nullptr)
+        : buffer_size_(buffer_size(sampling_frequency, buffer_ms))
+        , packets_(buffer_size_)
+        , reader_(packets_.subscribe())
+        , timeline_(pts_timeline ? pts_timeline
+                                 : std::make_shared<timeline>()) {
     }
     ~aac_pump() = default;
 public:
-    bool produce(std::string const& packet) {
-        if (!mutex_.try_lock()) {
-            return false;
-        }
-        if (packets_.size() > buffer_size_) {
-            auto empty = std::queue<std::string>{};
-            packets_.swap(empty);
-        }
-        packets_.push(packet);
-        mutex_.unlock();
-        std::this_thread::yield();
+    // every ADTS packet is a sync point
+    bool produce(frame const& packet) {
+        grow(packet.size());
+        stats_.produced(packet.size());
+        packets_.publish(stamped(packet), true);
+        notifier_.notify();
         return true;
     }
-    bool consume(std::string& packet) {
-       if (!mutex_.try_lock()) {
-            return false;
+    bool produce(std::string const& packet) {
+        return produce(frame::copy(packet));
+    }
+    // the pump's own reader, for a single consumer that did not subscribe()
+    bool consume(frame& packet) {
+        return reader_.read(packet);
+    }
+    // Every reader sees every packet; one that falls behind by more than
+    // buffer_size_ skips ahead to the newest packet.
+    reader subscribe() {
+        return packets_.subscribe();
+    }
+    // the PTS mapping shared by all pumps of one stream
+    std::shared_ptr<timeline> const& pts_timeline() const {
+        return timeline_;
+    }
+    // ingest to hand-off to the RTP sink, in microseconds
+    histogram& latency() {
+        return latency_;
+    }
+    // frames in, frames out per client
+    pump_stats& stats() {
+        return stats_;
+    }
+public:
+    // cb runs on the producer thread right after a frame became available
+    notifier::token attach(notifier::callback const& cb) {
+        return notifier_.attach(cb);
+    }
+    void detach(notifier::token t) {
+        notifier_.detach(t);
+    }
+public:
+    // frames evicted from the ring while a reader still held them
+    std::uint64_t contended() const {
+        return packets_.contended();
+    }
+    // the largest frame published so far, to size RTP sink buffers
+    std::size_t max_frame() const {
+        return max_frame_.load(std::memory_order_relaxed);
+    }
+    std::size_t size() const {
+        return packets_.size();
+    }
+    // packets skipped by all readers together
+    std::uint64_t dropped() const {
+        return packets_.skipped();
+    }
+private:
+    // frames nobody stamped entered the server just now
+    static frame stamped(frame const& f) {
+        if (frame::clock::time_point{} != f.ingest()) {
+            return f;
         }
-        if (packets_.empty()) {
-            mutex_.unlock();
-            std::this_thread::yield();
-            return false;
+        auto g = f;
+        return g.ingest(frame::clock::now());
+    }
+    // single producer, a plain store is enough
+    void grow(std::size_t size) {
+        if (size > max_frame_.load(std::memory_order_relaxed)) {
+            max_frame_.store(size, std::memory_order_relaxed);
         }
-        packet = packets_.front();
-        packets_.pop();
-        mutex_.unlock();
-        return true;
     }
-private:
     static inline unsigned buffer_size( unsigned sampling_frequency
                                       , unsigned buffer_ms) {
         auto const ms_pre_frame = double{1024 * 1000} / sampling_frequency;
@@ -58,9 +116,14 @@ private:
 public:
     unsigned buffer_size_;
 private:
-    std::queue<std::string> packets_;
+    broadcast_ring<frame> packets_;
+    reader reader_;
+    notifier notifier_;
 private:
-    std::mutex mutex_;
+    std::shared_ptr<timeline> timeline_;
+    histogram latency_;
+    pump_stats stats_;
+    std::atomic<std::size_t> max_frame_{0};
 };
 
 
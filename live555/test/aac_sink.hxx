@@ -6,6 +6,10 @@
 #include <MPEG4GenericRTPSink.hh>
 
 
+// With aggregated set, frames from aac_source come with their RFC 3640
+// AU-headers section written, so none is added. Each is one packet within
+// the default size; a fragment of a larger AU says so by an AU-size above
+// what it carries, only the packet completing the AU is marked.
 class aac_sink final : public MPEG4GenericRTPSink {
 public:
     aac_sink( UsageEnvironment& env
@@ -13,7 +17,8 @@ public:
             , std::uint8_t rtp_payload_fmt
             , std::uint32_t sampling_frequency
             , char const* config
-            , unsigned channels)
+            , unsigned channels
+            , bool aggregated = false)
         : MPEG4GenericRTPSink( env
                              , rtp
                              , rtp_payload_fmt
@@ -21,10 +26,60 @@ public:
                              , "audio"
                              , "AAC-hbr"
                              , config
-                             , channels){
+                             , channels)
+        , aggregated_(aggregated) {
         // EMPTY
     }
     ~aac_sink() = default;
+private:
+    virtual void doSpecialFrameHandling( unsigned fragmentation_offset
+                                       , unsigned char* frame_start
+                                       , unsigned frame_size
+                                       , struct timeval pts
+                                       , unsigned remaining) override {
+        if (!aggregated_) {
+            MPEG4GenericRTPSink::doSpecialFrameHandling( fragmentation_offset
+                                                       , frame_start
+                                                       , frame_size
+                                                       , pts
+                                                       , remaining);
+            return;
+        }
+        if (0 == remaining && closes(frame_start, frame_size)) {
+            setMarkerBit();
+        }
+        MultiFramedRTPSink::doSpecialFrameHandling( fragmentation_offset
+                                                  , frame_start
+                                                  , frame_size
+                                                  , pts
+                                                  , remaining);
+    }
+    virtual unsigned specialHeaderSize() const override {
+        return aggregated_ ? 0 : MPEG4GenericRTPSink::specialHeaderSize();
+    }
+private:
+    // A packet of whole frames closes them all. One AU-header with an
+    // AU-size above the bytes that follow starts a fragmented AU, which
+    // the packet bringing its last bytes closes.
+    bool closes(unsigned char const* frame, unsigned size) {
+        auto const header = 4u;
+        if (size < header || 16 != ((frame[0] << 8) | frame[1])) {
+            left_ = 0;
+            return true;
+        }
+        auto const au = static_cast<unsigned>((frame[2] << 8) | frame[3]) >> 3;
+        auto const carried = size - header;
+        if (0 == left_) {
+            left_ = au > carried ? au - carried : 0;
+        } else {
+            left_ = left_ > carried ? left_ - carried : 0;
+        }
+        return 0 == left_;
+    }
+private:
+    bool const aggregated_;
+    // bytes of a fragmented AU still to come
+    unsigned left_ = 0;
 };
 
 
@@ -11,33 +11,64 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <chrono>
 #include <string>
 #include <memory>
+#include <vector>
 #include <GroupsockHelper.hh>
 #include <FramedSource.hh>
+#include "./frame.hxx"
 #include "./aac_utils.hxx"
+#include "./adts.hxx"
 #include "./aac_pump.hxx"
+#include "./wakeup.hxx"
 
+//
+// - Raw AAC frames of a pump, for an MPEG4-generic AAC-hbr sink
+//    - One frame per RTP packet by default; aac_sink writes its AU header.
+//    - With max_frames above one, up to that many frames share a packet as
+//      an RFC 3640 aggregate this source writes itself: the AU-headers
+//      section, then the frames back to back. The first frame waits at most
+//      max_ms for the others, and a packet never grows past max_payload.
+//      A frame too large for one goes out in fragments, each with its own
+//      AU-headers section giving the whole frame's size; aac_sink marks the
+//      last one.
+//
 class aac_source final: public FramedSource {
 public:
     aac_source( UsageEnvironment& env
               , std::shared_ptr<aac_pump> pump
               , std::uint8_t profile
               , std::uint8_t sampling_freq_idx
-              , std::uint8_t channel_cfg)
+              , std::uint8_t channel_cfg
+              , unsigned max_frames = 1
+              , unsigned max_ms = 0)
         : FramedSource(env)
         , pump_(pump)
+        , reader_(pump_->subscribe())
+        , client_(pump_->stats().attach())
         , profile_(profile)
         , sampling_frequency_(sampling_frequency(sampling_freq_idx))
         , channels_(channel_cfg == 0 ? 2 : channel_cfg)
-        , usecs_pre_frame_((1024 * 1000000) / sampling_frequency(sampling_freq_idx)) {
+        , usecs_pre_frame_((1024 * 1000000) / sampling_frequency(sampling_freq_idx))
+        , max_frames_(0 == max_frames ? 1 : max_frames)
+        , max_wait_(std::chrono::milliseconds{max_ms})
+        , wakeup_(wakeup::of(env.taskScheduler())) {
         std::uint8_t specific_cfg[2] = {0};
         std::uint8_t const object_type = profile + 1;
         specific_cfg[0] = (object_type << 3) | (sampling_freq_idx >> 1);
         specific_cfg[1] = (sampling_freq_idx << 7) | (channel_cfg << 3);
         sprintf(config_, "%02X%02x", specific_cfg[0], specific_cfg[1]);
+        auto const w = wakeup_;
+        token_ = pump_->attach([w, this]() {
+            w->post(&aac_source::on_data, this);
+        });
+    }
+    virtual ~aac_source() {
+        pump_->detach(token_);
+        wakeup_->cancel(this);
+        envir().taskScheduler().unscheduleDelayedTask(timer_);
     }
-    virtual ~aac_source() = default;
 public:
     unsigned sampling_frequency() const {
         return sampling_frequency_;
@@ -48,86 +79,261 @@ public:
     char const* config() const {
         return config_;
     }
+    // frames carry their own AU-headers section, the sink must not add one
+    bool aggregated() const {
+        return max_frames_ > 1;
+    }
 private:
     static inline unsigned sampling_frequency(std::size_t i) {
-        static unsigned constexpr table[16] = {
-            96000 , 88200 , 64000 , 48000
-          , 44100 , 32000 , 24000 , 22050
-          , 16000 , 12000 , 11025 , 8000
-          , 7350  , 0     , 0     , 0
-        };
-        return table[i];
+        return adts::sampling_frequency(static_cast<unsigned>(i));
     }
 private:
     virtual void doGetNextFrame() override {
-        std::string packet;
-        if (!pump_->consume(packet) && packet.size() < 7) {
-            schedule();
+        deliver();
+    }
+private:
+    static void on_data(void* self) {
+        auto const source = static_cast<aac_source*>(self);
+        if (source->isCurrentlyAwaitingData()) {
+            source->deliver();
+        }
+    }
+    void deliver() {
+        if (aggregated()) {
+            aggregate();
             return;
         }
-        if (!check(packet)) {
-            schedule();
+        frame packet;
+        for (;reader_.read(packet);) {
+            auto const header = adts::parse(packet.data(), packet.size());
+            if (!get(packet, header)) {
+                continue;
+            }
+            pt(packet, header.raw_data_blocks());
+            latency(packet);
+            client_->behind(reader_.lag(), reader_.skipped());
+            FramedSource::afterGetting(this);
             return;
         }
-        get(packet);
-        pt();
-        schedule();
+        // Nothing buffered, the pump wakes us through on_data.
     }
 private:
-    bool check(std::string const& packet) {
-        auto const size = packet.size();
-        if (size < 7) {
-            return false;
-        }
-        if (!aac_utils::has_syncword(packet)) {
+    // An ADTS frame is at most 8191 bytes and aac_subsession reserved room
+    // for the largest one seen, the clamp only guards a foreign sink.
+    bool get(frame const& packet, adts::header const& header) {
+        if (!header.valid() || header.frame_length() != packet.size()) {
             return false;
         }
-        auto const len = aac_utils::packet_len(packet);
-        if (size != len) {
-            return false;
+        auto const data_size = header.payload_size();
+        fFrameSize = (data_size > fMaxSize) ? fMaxSize : data_size;
+        fNumTruncatedBytes = (data_size > fMaxSize) ? (data_size - fMaxSize)
+                                                    : 0;
+        memcpy(fTo, packet.data() + header.size(), fFrameSize);
+        client_->sent(fFrameSize);
+        if (0 != fNumTruncatedBytes) {
+            client_->truncated(fNumTruncatedBytes);
         }
         return true;
     }
-    void get(std::string const& packet) {
-        auto const packet_size = packet.size();
-        auto const protection_absent = static_cast<bool>(packet[1] & 0x01);
-        u_int16_t frame_length = ((packet[3] & 0x03) << 11)
-                               | (packet[4] << 3)
-                               | ((packet[5] & 0xE0) >> 5);
-        if (frame_length != packet_size) {
-            schedule();
+private:
+    struct unit final {
+        frame packet;
+        std::size_t offset;
+        std::size_t size;
+        unsigned blocks;
+    };
+    static void on_timer(void* self) {
+        auto const source = static_cast<aac_source*>(self);
+        source->timer_ = nullptr;
+        if (source->isCurrentlyAwaitingData()) {
+            source->deliver();
+        }
+    }
+    // Takes frames until max_frames are held or the next one would not fit,
+    // then sends; fewer wait for more until the first has waited max_ms.
+    void aggregate() {
+        if (0 != fragment_) {
+            fragment();
             return;
         }
-        auto const data_index = protection_absent ? 7 : 9;
-        auto const data_size = protection_absent ? (packet_size - 7)
-                                                 : (packet_size - 9);
-        fFrameSize = (data_size > fMaxSize) ? fMaxSize : data_size;
-        fNumTruncatedBytes = (data_size > fMaxSize) ? (data_size - fMaxSize)
-                                                    : 0;
-        memcpy(fTo, packet.c_str() + data_index, fFrameSize);
+        frame packet;
+        for (;units_.size() < max_frames_;) {
+            if (!next_.empty()) {
+                packet = next_;
+                next_ = frame{};
+            } else if (!reader_.read(packet)) {
+                break;
+            }
+            auto const header = adts::parse(packet.data(), packet.size());
+            if (!header.valid() || header.frame_length() != packet.size()) {
+                continue;
+            }
+            auto const size = header.payload_size();
+            if (!units_.empty() && held_ + au_header_size + size > room()) {
+                next_ = packet;
+                break;
+            }
+            units_.push_back({ packet
+                             , header.size()
+                             , size
+                             , header.raw_data_blocks()});
+            held_ += au_header_size + size;
+        }
+        if (units_.empty()) {
+            return;
+        }
+        // a frame over room() has to be fragmented, nothing joins it
+        auto const full = units_.size() == max_frames_ || !next_.empty()
+                       || held_ > room();
+        auto const waited = frame::clock::now()
+                          - units_.front().packet.ingest();
+        if (!full && waited < max_wait_) {
+            if (nullptr == timer_) {
+                auto const left = std::chrono::duration_cast
+                                  <std::chrono::microseconds>
+                                        (max_wait_ - waited).count();
+                timer_ = envir().taskScheduler().scheduleDelayedTask
+                                        (left, &aac_source::on_timer, this);
+            }
+            return;
+        }
+        envir().taskScheduler().unscheduleDelayedTask(timer_);
+        if (1 == units_.size() && held_ > room()) {
+            fragment();
+            return;
+        }
+        pack();
+        client_->behind(reader_.lag(), reader_.skipped());
+        FramedSource::afterGetting(this);
+    }
+    // RFC 3640 3.2.1, AAC-hbr: a 16 bit AU-headers-length in bits, then per
+    // frame a 13 bit AU-size and a 3 bit AU-index (delta), always 0 as the
+    // frames follow each other. A lone frame too large is fragment()ed, the
+    // clamp only guards a sink with less room than max_payload.
+    void pack() {
+        auto const n = units_.size();
+        auto const headers = section_size + au_header_size * n;
+        auto const to = reinterpret_cast<std::uint8_t*>(fTo);
+        auto const bits = 16 * n;
+        to[0] = static_cast<std::uint8_t>(bits >> 8);
+        to[1] = static_cast<std::uint8_t>(bits);
+        auto at = headers;
+        auto blocks = 0u;
+        fNumTruncatedBytes = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            auto const& u = units_[i];
+            auto const room = fMaxSize > at ? fMaxSize - at : 0;
+            auto const size = u.size > room ? room : u.size;
+            auto const au = static_cast<std::uint16_t>(size << 3);
+            to[section_size + 2 * i] = static_cast<std::uint8_t>(au >> 8);
+            to[section_size + 2 * i + 1] = static_cast<std::uint8_t>(au);
+            memcpy(to + at, u.packet.data() + u.offset, size);
+            at += size;
+            fNumTruncatedBytes += static_cast<unsigned>(u.size - size);
+            blocks += u.blocks;
+            latency(u.packet);
+        }
+        fFrameSize = static_cast<unsigned>(at);
+        pt(units_.front().packet, blocks);
+        client_->sent(fFrameSize);
+        if (0 != fNumTruncatedBytes) {
+            client_->truncated(fNumTruncatedBytes);
+        }
+        units_.clear();
+        held_ = 0;
     }
-    void pt() {
-        if (0 == fPresentationTime.tv_sec && 0 == fPresentationTime.tv_usec) {
+    // RFC 3640 3.2.3: every fragment carries the one AU-header with the size
+    // of the whole frame; it has the frame's PTS, the last its duration.
+    void fragment() {
+        auto const& u = units_.front();
+        auto const to = reinterpret_cast<std::uint8_t*>(fTo);
+        auto const au = static_cast<std::uint16_t>(u.size << 3);
+        to[0] = 0;
+        to[1] = 16;
+        to[section_size] = static_cast<std::uint8_t>(au >> 8);
+        to[section_size + 1] = static_cast<std::uint8_t>(au);
+        auto const left = u.size - fragment_;
+        auto const room = this->room() - au_header_size;
+        auto const size = left > room ? room : left;
+        memcpy( to + section_size + au_header_size
+              , u.packet.data() + u.offset + fragment_
+              , size);
+        fFrameSize = static_cast<unsigned>(section_size + au_header_size
+                                           + size);
+        fNumTruncatedBytes = 0;
+        if (0 == fragment_) {
+            pt(u.packet, u.blocks);
+            latency(u.packet);
+            client_->fragment();
+        }
+        fragment_ += size;
+        client_->sent(fFrameSize);
+        if (fragment_ < u.size) {
+            fDurationInMicroseconds = 0;
+        } else {
+            fDurationInMicroseconds = duration_;
+            fragment_ = 0;
+            units_.clear();
+            held_ = 0;
+        }
+        client_->behind(reader_.lag(), reader_.skipped());
+        FramedSource::afterGetting(this);
+    }
+    // what frames may take in a packet, less the AU-headers-length
+    std::size_t room() const {
+        auto const limit = fMaxSize < max_payload ? std::size_t{fMaxSize}
+                                                  : max_payload;
+        return limit - section_size;
+    }
+private:
+    // the pushed PTS when there is one, else a steady frame cadence
+    void pt(frame const& packet, unsigned blocks) {
+        if (packet.has_pts()) {
+            fPresentationTime = pump_->pts_timeline()->map(packet.pts(), packet.ingest());
+        } else if (0 == fPresentationTime.tv_sec
+                   && 0 == fPresentationTime.tv_usec) {
             gettimeofday(&fPresentationTime, nullptr);
         } else {
-            unsigned uSeconds = fPresentationTime.tv_usec + usecs_pre_frame_;
+            unsigned uSeconds = fPresentationTime.tv_usec + duration_;
             fPresentationTime.tv_sec += uSeconds / 1000000;
             fPresentationTime.tv_usec = uSeconds % 1000000;
         }
-        fDurationInMicroseconds = usecs_pre_frame_;
+        duration_ = usecs_pre_frame_ * blocks;
+        fDurationInMicroseconds = duration_;
     }
-    void schedule() {
-        auto& task = nextTask();
-        auto const f = reinterpret_cast<TaskFunc*>(FramedSource::afterGetting);
-        task = envir().taskScheduler().scheduleDelayedTask(0, f, this);
+    void latency(frame const& packet) {
+        auto const since = frame::clock::now() - packet.ingest();
+        auto const us = std::chrono::duration_cast<std::chrono::microseconds>
+                                (since).count();
+        pump_->latency().record(us < 0 ? 0 : static_cast<std::uint64_t>(us));
     }
 private:
     std::shared_ptr<aac_pump> pump_;
+    aac_pump::reader reader_;
+    std::shared_ptr<pump_stats::client> client_;
 private:
     unsigned profile_;
     unsigned sampling_frequency_;
     unsigned channels_;
     unsigned usecs_pre_frame_;
+    unsigned duration_ = 0;
+private:
+    // under the 1444 byte payload of a default live555 sink
+    static auto constexpr max_payload = std::size_t{1400};
+    static auto constexpr section_size = std::size_t{2};
+    static auto constexpr au_header_size = std::size_t{2};
+private:
+    unsigned max_frames_;
+    std::chrono::milliseconds max_wait_;
+    std::vector<unit> units_;
+    std::size_t held_ = 0;
+    frame next_;
+    // bytes of a lone frame already sent in fragments
+    std::size_t fragment_ = 0;
+    TaskToken timer_ = nullptr;
+private:
+    std::shared_ptr<wakeup> wakeup_;
+    notifier::token token_ = 0;
 private:
     char config_[5];
 };
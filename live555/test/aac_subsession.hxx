@@ -15,6 +15,7 @@
 #include "./aac_pump.hxx"
 #include "./aac_source.hxx"
 #include "./aac_sink.hxx"
+#include "./out_buffer.hxx"
 
 class aac_subsession final : public OnDemandServerMediaSubsession {
 public:
@@ -23,12 +24,16 @@ public:
                   , std::shared_ptr<aac_pump> const& pump
                   , std::uint8_t profile
                   , std::uint8_t sampling_freq_idx
-                  , std::uint8_t channel_cfg)
+                  , std::uint8_t channel_cfg
+                  , unsigned max_frames = 1
+                  , unsigned max_ms = 0)
         : OnDemandServerMediaSubsession(env, reused)
         , pump_(pump)
         , profile_(profile)
         , sampling_frequency_index_(sampling_freq_idx)
-        , channel_config_(channel_cfg)  {
+        , channel_config_(channel_cfg)
+        , max_frames_(max_frames)
+        , max_ms_(max_ms)  {
         // EMPTY
     }
 protected:
@@ -39,24 +44,31 @@ protected:
                            , pump_
                            , profile_
                            , sampling_frequency_index_
-                           , channel_config_);
+                           , channel_config_
+                           , max_frames_
+                           , max_ms_);
     }
     virtual RTPSink* createNewRTPSink( Groupsock* rtp
                                      , unsigned char rtp_payload_type_if_dynamic
                                      , FramedSource* src) override {
+        out_buffer::reserve(pump_->max_frame());
         aac_source* aac_src = reinterpret_cast<aac_source*>(src);
         return new aac_sink( envir()
                            , rtp
                            , rtp_payload_type_if_dynamic
                            , aac_src->sampling_frequency()
                            , aac_src->config()
-                           , aac_src->channels());
+                           , aac_src->channels()
+                           , aac_src->aggregated());
     }
 private:
     std::shared_ptr<aac_pump> pump_;
     std::uint8_t profile_;
     std::uint8_t sampling_frequency_index_;
     std::uint8_t channel_config_;
+    // RFC 3640 aggregation, up to max_frames per packet or max_ms of waiting
+    unsigned max_frames_;
+    unsigned max_ms_;
 };
 
 
@@ -11,6 +11,8 @@
 
 #include <cstdint>
 #include <string>
+#include "./adts.hxx"
+#include "./bit.hxx"
 
 
 struct aac_utils {
@@ -30,9 +32,7 @@ struct aac_utils {
         if (packet.size() < 6) {
             return 0;
         }
-        return   ((packet[3] & 0x03) << 11)
-               | (packet[4] << 3)
-               | ((packet[5] & 0xE0) >> 5);
+        return util::bit::field<30, 13>::get(packet.data());
     }
 
     static bool has_syncword(char const* bytes, std::size_t size) {
@@ -48,22 +48,15 @@ struct aac_utils {
         if (size < 3) {
             return 0;
         }
-        return   ((bytes[0] & 0x03) << 11)
-               | (bytes[1] << 3)
-               | ((bytes[2] & 0xE0) >> 5);
+        // the frame length starts 6 bits into the header's fourth byte
+        return util::bit::field<6, 13>::get(bytes);
     }
 
     static unsigned sampling_frequency(std::size_t i) {
         if (i > 15) {
             return 0;
         }
-        static unsigned constexpr table[16] = {
-            96000 , 88200 , 64000 , 48000
-          , 44100 , 32000 , 24000 , 22050
-          , 16000 , 12000 , 11025 , 8000
-          , 7350  , 0     , 0     , 0
-        };
-        return table[i];
+        return adts::sampling_frequency(static_cast<unsigned>(i));
     }
 };
 
@@ -9,10 +9,9 @@
 #define ADTS_HXX
 
 
-#include <climits>
-#include <bitset>
-#include <array>
+#include <cstddef>
 #include <cstdint>
+#include <array>
 #include "./bit.hxx"
 
 
@@ -107,11 +106,31 @@
 //      - ADTS Buffer Fullness
 //      - Number of Raw Data Blocks In Frame
 //
-
-class adts {
-    class header {
+// - Decoding
+//    - parse() loads the 7 header bytes once as a big-endian integer, every
+//      field is then a constant shift and mask of it (see bit.hxx). Nothing
+//      branches on the data, valid() included.
+//
+class adts final {
+public:
+    static auto constexpr header_size = std::size_t{7};
+    static auto constexpr crc_size = std::size_t{2};
+    static auto constexpr samples_per_raw_data_block = 1024u;
+public:
+    // 0 for the reserved and the explicit indices
+    static unsigned sampling_frequency(unsigned index) {
+        static unsigned constexpr table[16] = {
+            96000 , 88200 , 64000 , 48000
+          , 44100 , 32000 , 24000 , 22050
+          , 16000 , 12000 , 11025 , 8000
+          , 7350  , 0     , 0     , 0
+        };
+        return table[index & 0x0f];
+    }
+public:
+    class header final {
     public:
-        class fixed {
+        class fixed final {
         public:
             fixed() = default;
             fixed( unsigned id
@@ -124,7 +143,7 @@ class adts {
                  , unsigned original_copy
                  , unsigned home)
                 : id_(id)
-                , layer_( layer_)
+                , layer_(layer)
                 , protection_absent_(protection_absent)
                 , profile_object_type_(profile_object_type)
                 , sampling_frequency_index_(sampling_frequency_index)
@@ -207,79 +226,33 @@ class adts {
                 return *this;
             }
         private:
-            static fixed parse(std::array<std::uint8_t, 7> const& bytes) {
-                if (!parse_sw(bytes)) {
-                    return fixed{};
-                }
-                //return fixed{parse_id(bytes), parse}
-                //auto const id = parse_id(bytes);
-            }
-        private:
-            static inline bool parse_sw(std::array<uint8_t, 7> const& bytes) {
-                return is_ff(bytes[0]) && is_f(bytes[1]);
-            }
-            static unsigned parse_id(std::array<std::uint8_t, 7> const& bytes) {
-                return bytes[1] >> 3 && 0x01;
-            }
-            static unsigned parse_l(std::array<std::uint8_t, 7> const& bytes) {
-                return bytes[1] >> 1 && 0x03;
-            }
-            static unsigned parse_pa(std::array<std::uint8_t, 7> const& bytes) {
-                return bytes[1] >> 0 && 0x01;
-            }
-            static unsigned parse_pot(std::array<std::uint8_t, 7> const& bytes) {
-                return bytes[2] >> 6 && 0x02;
-            }
-            static unsigned parse_sfi(std::array<std::uint8_t, 7> const& bytes) {
-                return bytes[2] >> 6 && 0x02;
-            }
-        private:
-            static inline bool is_ff(uint8_t b) {
-                return 0x0ff == util::bit::extract<8, 0, 8>(b);
-            }
-            static inline bool is_f(uint8_t b) {
-                return 0x0f == util::bit::extract<8, 0, 4>(b);
-            }
-            static inline unsigned extract(uint8_t b, std::size_t index, std::size_t size) {
-                return b & 0xff;
-            }
-        private:
-            unsigned id_;
-            unsigned layer_;
-            unsigned protection_absent_;
-            unsigned profile_object_type_;
-            unsigned sampling_frequency_index_;
-            unsigned private_bit_;
-            unsigned channel_configuration_;
-            unsigned original_copy_;
-            unsigned home_;
-        private:
-            unsigned id_;
-            unsigned layer_;
-            unsigned protection_absent_;
-            unsigned profile_object_type_;
-            unsigned sampling_frequency_index_;
-            unsigned private_bit_;
-            unsigned channel_configuration_;
-            unsigned original_copy_;
-            unsigned home_;
+            unsigned id_ = 0;
+            unsigned layer_ = 0;
+            unsigned protection_absent_ = 1;
+            unsigned profile_object_type_ = 0;
+            unsigned sampling_frequency_index_ = 0;
+            unsigned private_bit_ = 0;
+            unsigned channel_configuration_ = 0;
+            unsigned original_copy_ = 0;
+            unsigned home_ = 0;
         };
 
-        class variable {
+        class variable final {
         public:
+            variable() = default;
             variable( unsigned copyright_id_bit
                     , unsigned copyright_id_start
                     , unsigned aac_frame_length
                     , unsigned adts_buffer_fullness
                     , unsigned number_of_raw_data_blocks_in_frame)
-            : copyright_id_bit_(copyright_id_bit)
-            , copyright_id_start_(copyright_id_start)
-            , aac_frame_length_(aac_frame_length)
-            , adts_buffer_fullness_(adts_buffer_fullness)
-            , number_of_raw_data_blocks_in_frame_
-            ( number_of_raw_data_blocks_in_frame) {
-            // EMPTY
-        }
+                : copyright_id_bit_(copyright_id_bit)
+                , copyright_id_start_(copyright_id_start)
+                , aac_frame_length_(aac_frame_length)
+                , adts_buffer_fullness_(adts_buffer_fullness)
+                , number_of_raw_data_blocks_in_frame_
+                  ( number_of_raw_data_blocks_in_frame) {
+                // EMPTY
+            }
         public:
             unsigned copyright_id_bit() const {
                 return copyright_id_bit_;
@@ -294,6 +267,7 @@ class adts {
             }
             variable& copyright_id_start(unsigned start) {
                 copyright_id_start_ = start;
+                return *this;
             }
 
             unsigned aac_frame_length() const {
@@ -301,6 +275,7 @@ class adts {
             }
             variable& aac_frame_length(unsigned length) {
                 aac_frame_length_ = length;
+                return *this;
             }
 
             unsigned adts_buffer_fullness() const {
@@ -308,6 +283,7 @@ class adts {
             }
             variable& adts_buffer_fullness(unsigned fullness) {
                 adts_buffer_fullness_ = fullness;
+                return *this;
             }
 
             unsigned number_of_raw_data_blocks_in_frame() const {
@@ -315,42 +291,94 @@ class adts {
             }
             variable& number_of_raw_data_blocks_in_frame(unsigned number) {
                 number_of_raw_data_blocks_in_frame_ = number;
+                return *this;
             }
         private:
-            unsigned copyright_id_bit_;
-            unsigned copyright_id_start_;
-            unsigned aac_frame_length_;
-            unsigned adts_buffer_fullness_;
-            unsigned number_of_raw_data_blocks_in_frame_;
+            unsigned copyright_id_bit_ = 0;
+            unsigned copyright_id_start_ = 0;
+            unsigned aac_frame_length_ = 0;
+            unsigned adts_buffer_fullness_ = 0;
+            unsigned number_of_raw_data_blocks_in_frame_ = 0;
         };
     public:
-        static header parse(std::array<std::uint8_t, 7> const& bytes) {
-
+        header() = default;
+        explicit header(std::uint64_t bits)
+            : bits_(bits) {
+            // EMPTY
         }
-    private:
-        template< std::size_t N
-                , std::size_t Index
-                , std::size_t Bits
-                , std::enable_if_t<  (0 != N)
-                                  && (Bits > 0)
-                                  && ((Index + Bits) < sizeof(std::uint8_t) * N)
-                                  && (Bits < sizeof(unsigned))
-                                  >
-                >
-        static inline unsigned parse(std::array<std::uint8_t, N> const& bytes) {
-            auto const byte_index = Index / sizeof(std::uint8_t);
-            auto const bits_shift = Index % sizeof(std::uint8_t) + bits - 1;
-            auto const byte_count = Bits / sizeof(std::uint8_t);
-
-            for ()
+    public:
+        fixed fixed_header() const {
+            return fixed{ field<12, 1>()
+                        , field<13, 2>()
+                        , field<15, 1>()
+                        , field<16, 2>()
+                        , field<18, 4>()
+                        , field<22, 1>()
+                        , field<23, 3>()
+                        , field<26, 1>()
+                        , field<27, 1>()};
+        }
+        variable variable_header() const {
+            return variable{ field<28, 1>()
+                           , field<29, 1>()
+                           , field<30, 13>()
+                           , field<43, 11>()
+                           , field<54, 2>()};
+        }
+        // syncword, layer and a frame length covering at least the header
+        bool valid() const {
+            return 0 != ( (0x0fff == field<0, 12>())
+                        & (0 == field<13, 2>())
+                        & (frame_length() >= size()));
+        }
+        bool has_crc() const {
+            return 0 == field<15, 1>();
+        }
+        // header bytes including the CRC, if any
+        std::size_t size() const {
+            return header_size + crc_size * (1 - field<15, 1>());
+        }
+        // the whole packet, header included
+        std::size_t frame_length() const {
+            return field<30, 13>();
+        }
+        std::size_t payload_size() const {
+            return valid() ? frame_length() - size() : 0;
+        }
+        unsigned raw_data_blocks() const {
+            return field<54, 2>() + 1;
+        }
+        unsigned samples() const {
+            return raw_data_blocks() * samples_per_raw_data_block;
+        }
+        unsigned sampling_frequency() const {
+            return adts::sampling_frequency(field<18, 4>());
         }
     private:
-        fixed fixed_;
-        variable variable_;
+        template<std::size_t Index, std::size_t Size>
+        unsigned field() const {
+            return util::bit::extract<header_size * 8, Index, Size>(bits_);
+        }
     private:
+        std::uint64_t bits_ = 0;
     };
 public:
-private:
+    static header parse(std::array<std::uint8_t, header_size> const& bytes) {
+        return parse(bytes.data());
+    }
+    // an invalid header when fewer than header_size bytes are at hand
+    static header parse(char const* bytes, std::size_t size) {
+        if (size > header_size) {
+            // a whole word is readable, one load instead of three
+            return header{util::bit::fetch<8>::from(bytes) >> 8};
+        }
+        return size < header_size ? header{} : parse(bytes);
+    }
+    // bytes must hold at least header_size bytes
+    template<typename Byte>
+    static header parse(Byte const* bytes) {
+        return header{util::bit::fetch<header_size>::from(bytes)};
+    }
 };
 
 
@@ -12,8 +12,18 @@
 #include <cstddef>
 #include <type_traits>
 #include <memory>
+#include <utility>
+#include "./buffer_pool.hxx"
 
 
+//
+// - Refcounted array of T
+//    - make(), own() and wrap() keep the array behind a std::shared_ptr,
+//      which also lets mapped_file hand its mapping out with a deleter.
+//    - pooled() takes an uninitialized block from buffer_pool instead: the
+//      refcount lives in the block, there is no control block, and the
+//      block goes back to the pool when the last copy drops.
+//
 template<typename T>
 class arrptr {
 public:
@@ -30,7 +40,9 @@ public:
                 , typename
                 = typename std::enable_if_t< std::is_convertible<X*, TT*>::value
                                            , void>>
-        default_deleter(default_deleter<X>const&) throw() = default;
+        default_deleter(default_deleter<X>const&) throw() {
+            // Empty.
+        }
 
         void operator() (TT* ptr) const throw() {
             static_assert(0 < sizeof(TT), "can't delete an incomplete type");
@@ -46,7 +58,9 @@ public:
                 , typename
                 = typename std::enable_if_t< std::is_convertible<X*, TT*>::value
                                            , void>>
-        trivial_deleter(trivial_deleter<X>const&) throw() = default;
+        trivial_deleter(trivial_deleter<X>const&) throw() {
+            // Empty.
+        }
 
         void operator() (TT* ptr) const throw() {
             static_assert(0 < sizeof(TT), "can't delete an incomplete type");
@@ -65,10 +79,48 @@ public:
     static arrptr wrap(element_type* ptr, std::size_t size) {
         return arrptr(ptr, size, trivial_deleter<element_type>());
     }
+    static arrptr pooled(std::size_t size) {
+        static_assert( std::is_trivially_copyable<element_type>::value
+                     , "a pooled block is never constructed");
+        static_assert( alignof(element_type) <= alignof(buffer_pool::block)
+                     , "a pooled block is not aligned for this type");
+        arrptr a;
+        if (0 != size) {
+            a.block_ = buffer_pool::acquire(size * sizeof(element_type));
+            a.size_ = size;
+        }
+        return a;
+    }
 
 public:
     arrptr() = default;
-    ~arrptr() = default;
+    ~arrptr() {
+        unpool();
+    }
+    arrptr(arrptr const& other)
+        : ptr_(other.ptr_)
+        , block_(other.block_)
+        , size_(other.size_) {
+        if (nullptr != block_) {
+            buffer_pool::retain(block_);
+        }
+    }
+    arrptr(arrptr&& other) noexcept
+        : ptr_(std::move(other.ptr_))
+        , block_(std::exchange(other.block_, nullptr))
+        , size_(std::exchange(other.size_, 0)) {
+        // Empty.
+    }
+    arrptr& operator=(arrptr const& other) {
+        if (this != &other) {
+            arrptr{other}.swap(*this);
+        }
+        return *this;
+    }
+    arrptr& operator=(arrptr&& other) noexcept {
+        arrptr{std::move(other)}.swap(*this);
+        return *this;
+    }
 private:
     explicit arrptr(size_type size, bool zero = true)
         : ptr_(ptr(size, zero), default_deleter<element_type>())
@@ -83,23 +135,36 @@ private:
     }
 public:
     element_type* ptr() const {
-        return ptr_.get();
+        return nullptr != block_
+             ? reinterpret_cast<element_type*>(block_->data())
+             : ptr_.get();
     }
     size_type size() const {
         return size_;
     }
+    bool is_pooled() const {
+        return nullptr != block_;
+    }
+    void swap(arrptr& other) noexcept {
+        ptr_.swap(other.ptr_);
+        std::swap(block_, other.block_);
+        std::swap(size_, other.size_);
+    }
     self_type& reset() {
+        unpool();
         ptr_.reset();
         size_ = 0;
         return *this;
     }
     self_type& reset(size_type size, bool zero = true) {
-        auto const ptr = ptr(size, zero);
-        ptr_.reset(fix_ptr(ptr, size));
-        size_ = fix_size(ptr, size);
+        unpool();
+        auto const p = ptr(size, zero);
+        ptr_.reset(fix_ptr(p, size), default_deleter<element_type>());
+        size_ = fix_size(p, size);
         return *this;
     }
     self_type& reset(element_type* ptr, std::size_t size, bool owned = false) {
+        unpool();
         if (owned) {
             ptr_.reset(fix_ptr(ptr, size), default_deleter<element_type>());
         } else {
@@ -110,14 +175,20 @@ public:
     }
     template<typename D>
     self_type& reset(element_type* ptr, std::size_t size, D deleter) {
+        unpool();
         ptr_.reset(fix_ptr(ptr, size), deleter);
         size_ = fix_size(ptr, size);
         return *this;
     }
     explicit operator bool () const throw() {
-        return ptr_ && check(ptr_.get(), size_);
+        return check(ptr(), size_);
     }
 private:
+    void unpool() {
+        if (nullptr != block_) {
+            buffer_pool::release(std::exchange(block_, nullptr));
+        }
+    }
     inline static element_type* fix_ptr(element_type* ptr, size_type size) {
         return check(ptr, size) ? ptr : nullptr;
     }
@@ -134,6 +205,7 @@ private:
     }
 private:
     std::shared_ptr<element_type> ptr_;
+    buffer_pool::block* block_ = nullptr;
     size_type size_ = 0;
 };
 
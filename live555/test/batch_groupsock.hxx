@@ -0,0 +1,376 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef BATCH_GROUPSOCK_HXX
+#define BATCH_GROUPSOCK_HXX
+
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <Groupsock.hh>
+#include <GroupsockHelper.hh>
+
+#if defined(__linux__)
+#   include <netinet/in.h>
+#   include <netinet/udp.h>
+#   include <sys/socket.h>
+#   ifndef UDP_SEGMENT
+#       define UDP_SEGMENT 103
+#   endif
+#endif
+
+
+//
+// - RTP egress that sends an access unit at a time
+//    - The sink hands over one packet per output() call; the packet is
+//      copied and held until the one carrying the RTP marker bit, the last
+//      of its access unit, arrives. A batch that fills up, or a packet left
+//      alone for max_hold_us, goes out as well.
+//    - A flush is one sendmmsg() for every packet and every destination of
+//      the groupsock, which with a reused source is every client of the
+//      channel.
+//    - Where the kernel has UDP GSO, a run of equally sized packets to one
+//      destination (the FU-A fragments of a NAL) is a single message the
+//      kernel cuts into datagrams; the first refusal turns GSO off and
+//      what it refused goes again a packet per message. Datagrams cut that
+//      way count in datagrams() only once sent.
+//    - With pacing_us set, a batch leaves burst packets at a time, pacing_us
+//      apart, so a large IDR does not overflow a switch queue. A sink that
+//      outruns the pacing fills the queue up to max_queue packets, past
+//      that the newest are dropped and counted in dropped().
+//    - Packets too big to batch, or sent with no destinations, go straight
+//      to Groupsock, after whatever is queued so RTP order holds.
+//    - Elsewhere than Linux packets go out one sendto() each, as before.
+//
+class batch_groupsock final : public Groupsock {
+public:
+    batch_groupsock( UsageEnvironment& env
+                   , struct in_addr const& addr
+                   , Port port
+                   , unsigned pacing_us = 0)
+        : Groupsock(env, addr, port, 255)
+        , pacing_us_(pacing_us) {
+        bytes_.reserve(max_batch * max_packet);
+        packets_.reserve(max_batch);
+#if defined(__linux__)
+        // a kernel without UDP GSO would send a run as one huge datagram
+        int segment = 0;
+        socklen_t len = sizeof(segment);
+        gso_ = 0 == ::getsockopt( socketNum()
+                                , SOL_UDP
+                                , UDP_SEGMENT
+                                , &segment
+                                , &len);
+#endif
+    }
+    virtual ~batch_groupsock() {
+        envir().taskScheduler().unscheduleDelayedTask(task_);
+    }
+public:
+    virtual Boolean output( UsageEnvironment& env
+                          , unsigned char* buffer
+                          , unsigned size
+                          , DirectedNetInterface* = nullptr) override {
+        if (size > max_packet || nullptr == fDests) {
+            drain();
+            return Groupsock::output(env, buffer, size);
+        }
+        if (packets_.size() >= max_queue) {
+            ++dropped_;
+            return False;
+        }
+        packets_.push_back({bytes_.size(), size});
+        bytes_.insert(bytes_.end(), buffer, buffer + size);
+        if (nullptr != task_ && paced_) {
+            // the paced flush picks it up
+            return True;
+        }
+        auto const marker = size > 1 && 0 != (buffer[1] & 0x80);
+        if (marker || packets_.size() >= max_batch) {
+            flush();
+        } else if (nullptr == task_) {
+            schedule(max_hold_us, false);
+        }
+        return True;
+    }
+public:
+    // datagrams handed to the kernel, and the calls it took
+    std::uint64_t datagrams() const {
+        return datagrams_;
+    }
+    std::uint64_t syscalls() const {
+        return syscalls_;
+    }
+    // packets the sink handed over while the queue was full
+    std::uint64_t dropped() const {
+        return dropped_;
+    }
+private:
+    struct packet final {
+        std::size_t offset;
+        std::size_t size;
+    };
+private:
+    static void on_flush(void* self) {
+        auto const s = static_cast<batch_groupsock*>(self);
+        s->task_ = nullptr;
+        s->flush();
+    }
+    void schedule(unsigned us, bool paced) {
+        paced_ = paced;
+        task_ = envir().taskScheduler().scheduleDelayedTask( us
+                                                           , &on_flush
+                                                           , this);
+    }
+    void flush() {
+        envir().taskScheduler().unscheduleDelayedTask(task_);
+        auto const burst = 0 == pacing_us_ ? packets_.size()
+                                           : std::size_t{max_burst};
+        auto const end = sent_ + burst < packets_.size() ? sent_ + burst
+                                                         : packets_.size();
+        send(sent_, end);
+        sent_ = end;
+        if (sent_ < packets_.size()) {
+            schedule(pacing_us_, true);
+            return;
+        }
+        clear();
+    }
+    // everything queued at once, pacing or not
+    void drain() {
+        envir().taskScheduler().unscheduleDelayedTask(task_);
+        send(sent_, packets_.size());
+        clear();
+    }
+    void clear() {
+        packets_.clear();
+        bytes_.clear();
+        sent_ = 0;
+    }
+    // packets [first, last) to every destination
+    void send(std::size_t first, std::size_t last) {
+        destinations();
+        if (first == last || addrs_.empty()) {
+            return;
+        }
+#if defined(__linux__)
+        if (gso_) {
+            send_gso(first, last);
+            return;
+        }
+        messages_.clear();
+        iovs_.resize((last - first) * addrs_.size());
+        auto iov = iovs_.data();
+        for (auto& a : addrs_) {
+            for (auto i = first; i < last; ++i, ++iov) {
+                *iov = {bytes_.data() + packets_[i].offset, packets_[i].size};
+                messages_.push_back(message(a, iov, nullptr));
+            }
+        }
+        send_all();
+#else
+        for (auto& a : addrs_) {
+            for (auto i = first; i < last; ++i) {
+                ::sendto( socketNum()
+                        , bytes_.data() + packets_[i].offset
+                        , static_cast<int>(packets_[i].size)
+                        , 0
+                        , reinterpret_cast<struct sockaddr*>(&a)
+                        , sizeof(a));
+                ++datagrams_;
+                ++syscalls_;
+            }
+        }
+#endif
+    }
+    void destinations() {
+        addrs_.clear();
+        for (auto d = fDests; nullptr != d; d = d->fNext) {
+            struct sockaddr_in a;
+            std::memset(&a, 0, sizeof(a));
+            a.sin_family = AF_INET;
+            a.sin_addr = d->fGroupEId.groupAddress();
+            a.sin_port = d->fGroupEId.portNum();
+            addrs_.push_back(a);
+        }
+    }
+#if defined(__linux__)
+    // Packets sit back to back in bytes_, so a run is one iovec; it ends at
+    // the first packet of another size, after a shorter one, or at the GSO
+    // limits.
+    void send_gso(std::size_t first, std::size_t last) {
+        messages_.clear();
+        iovs_.clear();
+        segments_.clear();
+        iovs_.reserve((last - first) * addrs_.size());
+        segments_.reserve((last - first) * addrs_.size());
+        for (auto& a : addrs_) {
+            for (auto i = first; i < last;) {
+                auto const segment = packets_[i].size;
+                auto j = i + 1;
+                auto bytes = segment;
+                for (; j < last && j - i < max_segments
+                       && bytes + packets_[j].size <= max_gso_bytes
+                       && packets_[j].size <= segment;) {
+                    bytes += packets_[j].size;
+                    if (packets_[j++].size < segment) {
+                        break;
+                    }
+                }
+                iovs_.push_back({bytes_.data() + packets_[i].offset, bytes});
+                segments_.emplace_back();
+                auto& s = segments_.back();
+                s.value = static_cast<std::uint16_t>(segment);
+                messages_.push_back(message( a
+                                           , &iovs_.back()
+                                           , 1 == j - i ? nullptr : &s));
+                i = j;
+            }
+        }
+        auto const refused = send_all();
+        if (refused < messages_.size()) {
+            resend_plain(refused);
+        }
+    }
+    // GSO is off for good; the refused message and those after it go again,
+    // each run cut back into the packets it was made of.
+    void resend_plain(std::size_t from) {
+        gso_ = false;
+        auto const rest = std::vector<struct mmsghdr>( messages_.begin() + from
+                                                     , messages_.end());
+        auto count = std::size_t{0};
+        for (auto& m : rest) {
+            count += datagrams_of(m);
+        }
+        auto plain = std::vector<struct iovec>{};
+        plain.reserve(count);
+        messages_.clear();
+        for (auto& m : rest) {
+            auto const a = static_cast<struct sockaddr_in*>
+                                      (m.msg_hdr.msg_name);
+            auto const& v = *m.msg_hdr.msg_iov;
+            auto const bytes = static_cast<unsigned char*>(v.iov_base);
+            auto const segment = segment_size(m);
+            for (auto at = std::size_t{0}; at < v.iov_len; at += segment) {
+                auto const size = v.iov_len - at < segment ? v.iov_len - at
+                                                           : segment;
+                plain.push_back({bytes + at, size});
+                messages_.push_back(message(*a, &plain.back(), nullptr));
+            }
+        }
+        send_all();
+    }
+    static std::size_t segment_size(struct mmsghdr const& m) {
+        auto const c = CMSG_FIRSTHDR(&m.msg_hdr);
+        if (nullptr == c) {
+            return m.msg_hdr.msg_iov->iov_len;
+        }
+        auto segment = std::uint16_t{0};
+        std::memcpy(&segment, CMSG_DATA(c), sizeof(segment));
+        return segment;
+    }
+    // what the kernel makes of one message
+    static std::size_t datagrams_of(struct mmsghdr const& m) {
+        auto const segment = segment_size(m);
+        return 0 == segment ? 1
+                            : (m.msg_hdr.msg_iov->iov_len + segment - 1)
+                              / segment;
+    }
+    struct control final {
+        alignas(struct cmsghdr) char bytes[CMSG_SPACE(sizeof(std::uint16_t))];
+        std::uint16_t value;
+    };
+    static struct mmsghdr message( struct sockaddr_in& a
+                                 , struct iovec* iov
+                                 , control* gso) {
+        struct mmsghdr m;
+        std::memset(&m, 0, sizeof(m));
+        m.msg_hdr.msg_name = &a;
+        m.msg_hdr.msg_namelen = sizeof(a);
+        m.msg_hdr.msg_iov = iov;
+        m.msg_hdr.msg_iovlen = 1;
+        if (nullptr != gso) {
+            std::memset(gso->bytes, 0, sizeof(gso->bytes));
+            m.msg_hdr.msg_control = gso->bytes;
+            m.msg_hdr.msg_controllen = sizeof(gso->bytes);
+            auto const c = CMSG_FIRSTHDR(&m.msg_hdr);
+            c->cmsg_level = SOL_UDP;
+            c->cmsg_type = UDP_SEGMENT;
+            c->cmsg_len = CMSG_LEN(sizeof(std::uint16_t));
+            std::memcpy(CMSG_DATA(c), &gso->value, sizeof(gso->value));
+        }
+        return m;
+    }
+    // A full socket buffer drops the rest, as a failed sendto() would. The
+    // index of a GSO message the kernel refused is returned, so the caller
+    // can send it and the rest another way; messages_.size() otherwise.
+    std::size_t send_all() {
+        auto m = messages_.data();
+        auto n = messages_.size();
+        for (;0 != n;) {
+            auto const count = n > max_messages ? max_messages : n;
+            auto const sent = ::sendmmsg( socketNum()
+                                        , m
+                                        , static_cast<unsigned>(count)
+                                        , 0);
+            ++syscalls_;
+            if (sent < 0) {
+                if (EINTR == errno) {
+                    continue;
+                }
+                auto const refused = (EIO == errno || EINVAL == errno)
+                                   && nullptr != m->msg_hdr.msg_control;
+                return refused ? static_cast<std::size_t>(m - messages_.data())
+                               : messages_.size();
+            }
+            if (0 == sent) {
+                break;
+            }
+            for (auto i = 0; i < sent; ++i, ++m) {
+                datagrams_ += datagrams_of(*m);
+            }
+            n -= static_cast<std::size_t>(sent);
+        }
+        return messages_.size();
+    }
+#endif
+private:
+    // one access unit of FU-A packets from a 1080p IDR, give or take
+    static auto constexpr max_batch = std::size_t{128};
+    static auto constexpr max_queue = 4 * max_batch;
+    static auto constexpr max_packet = std::size_t{1500};
+    static auto constexpr max_hold_us = 2000u;
+    static auto constexpr max_burst = 16u;
+    static auto constexpr max_messages = std::size_t{1024};
+    // UDP_MAX_SEGMENTS, and what fits one IPv4 UDP datagram
+    static auto constexpr max_segments = std::size_t{64};
+    static auto constexpr max_gso_bytes = std::size_t{65507};
+private:
+    unsigned const pacing_us_;
+    std::vector<unsigned char> bytes_;
+    std::vector<packet> packets_;
+    std::size_t sent_ = 0;
+    TaskToken task_ = nullptr;
+    bool paced_ = false;
+    std::vector<struct sockaddr_in> addrs_;
+#if defined(__linux__)
+    bool gso_ = false;
+    std::vector<struct mmsghdr> messages_;
+    std::vector<struct iovec> iovs_;
+    std::vector<control> segments_;
+#endif
+private:
+    std::uint64_t datagrams_ = 0;
+    std::uint64_t syscalls_ = 0;
+    std::uint64_t dropped_ = 0;
+};
+
+
+#endif // BATCH_GROUPSOCK_HXX
@@ -9,10 +9,26 @@
 #define UTIL_BIT_HXX
 
 
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <type_traits>
 #include <array>
+#if defined(_MSC_VER)
+#   include <stdlib.h>
+#endif
+
 
+//
+// - Compile time bit fields
+//    - Bits are numbered from the most significant bit of the first byte,
+//      the way bitstream specifications draw them.
+//    - Every field<Index, Size> is resolved at compile time to the bytes it
+//      covers, a shift and a mask; reading it is one unaligned load of at
+//      most 8 bytes plus a byte swap, no loop and no branch.
+//    - load<> is the constexpr spelling of the same load, fetch<> the one
+//      compilers reliably turn into a single mov and bswap.
+//
 namespace util {
 namespace bit {
     // integer
@@ -32,7 +48,7 @@ namespace bit {
 
     template<>
     struct integer<8> {
-        using type = uint_least8_t;
+        using type = std::uint_least8_t;
         static auto constexpr max = UINT_LEAST8_MAX;
     };
 
@@ -62,200 +78,133 @@ namespace bit {
     template<std::size_t N>
     static auto constexpr integer_m = integer<N>::max;
 
-    // mask_helper
-    template< std::size_t N
-            , typename = std::enable_if_t<(N > 0)>
+    // ones, the Size low bits set
+    template< std::size_t Size
+            , typename = std::enable_if_t<(Size > 0 && Size <= 64)>
             >
-    struct mask_helper {
-        static integer_t<N> constexpr value = (1 << (N-1))
-                                            | mask_helper<N - 1>::value;
+    struct ones {
+        static std::uint64_t constexpr value = (64 == Size)
+                                             ? ~std::uint64_t{0}
+                                             : (std::uint64_t{1} << (Size % 64))
+                                             - 1;
     };
 
-    template<>
-    struct mask_helper<1> {
-        static integer_t<1> constexpr value = 1;
-    };
-
-    // mask_helper_v
-    template< std::size_t N>
-    static auto constexpr mask_helper_v = mask_helper<N>::value;
+    // ones_v
+    template<std::size_t Size>
+    static auto constexpr ones_v = ones<Size>::value;
 
-    // mask
+    // mask, bits Index .. Index + Size - 1 of an N bit integer
     template< std::size_t N
             , std::size_t Index
             , std::size_t Size
             , typename = std::enable_if_t<( N > 0
-                                         && Index >= 0
-                                         && Index < N
+                                         && N <= 64
                                          && Size > 0
-                                         && Size <= N
                                          && Index + Size <= N
                                          )>
             >
     struct mask {
-        static auto constexpr value = mask_helper_v<Size> << (N - Index + Size);
+        static auto constexpr shift = N - Index - Size;
+        static auto constexpr value = static_cast<integer_t<N>>
+                                      (ones_v<Size> << shift);
     };
 
     // mask_v
     template<std::size_t N, std::size_t Index, std::size_t Size>
     static auto constexpr mask_v = mask<N, Index, Size>::value;
 
+    // extract
     template< std::size_t N
             , std::size_t Index
             , std::size_t Size
-            , typename = std::enable_if_t<( N > 0
-                                         && Index >= 0
-                                         && Index < N
-                                         && Size > 0
-                                         && Size <= N
-                                         && Index + Size <= N
-                                         )>
             >
-    integer_t<Size> extract(integer_t<N> i) {
-        return i | mask_v<N, Index, Size>;
+    integer_t<Size> constexpr extract(integer_t<N> i) {
+        return static_cast<integer_t<Size>>
+               ((i & mask_v<N, Index, Size>) >> mask<N, Index, Size>::shift);
     }
 
-#if 0
-    // cover
-    template< std::size_t Index
-            , std::size_t Size
-            , typename = std::enable_if_t<(Index >= 0 && Size > 0)>
-            >
-    struct cover {
-        static auto constexpr value = (Index + Size) / 8 - Index / 8 + 1;
-    };
-
-    // cover_v
-    template<std::size_t Index, std::size_t Size>
-    static auto constexpr cover_v = cover<Index, Size>::value;
-
-    // head
-    template< std::size_t Index
-            , std::size_t Size
-            , typename = std::enable_if_t<(Index >= 0 && Size > 0)>
-            >
-    struct head {
-        static auto constexpr byte = Index / 8;
-        static auto constexpr index = Index % 8;
-        static auto constexpr size = 8 - index;
-    };
-
-    // head_b
-    template<std::size_t Index, std::size_t Size>
-    static auto constexpr head_b = head<Index, Size>::byte;
-
-    // head_i
-    template<std::size_t Index, std::size_t Size>
-    static auto constexpr head_i = head<Index, Size>::index;
-
-    // head_s
-    template<std::size_t Index, std::size_t Size>
-    static auto constexpr head_s = head<Index, Size>::size;
-
-    // has_tail
-    template< std::size_t Index
-            , std::size_t Size
-            , typename = std::enable_if_t<(Index >= 0 && Size > 0)>
-            >
-    struct has_tail {
-        static auto constexpr value = (cover_v<Index, Size>) > 1;
+    // load, Count bytes as one big-endian integer
+    template<std::size_t Count>
+    struct load {
+        template<typename Byte>
+        static std::uint64_t constexpr from(Byte const* bytes) {
+            return (load<Count - 1>::from(bytes) << 8)
+                 | static_cast<std::uint8_t>(bytes[Count - 1]);
+        }
     };
 
-    // has_tail_v
-    template<std::size_t Index, std::size_t Size>
-    static auto constexpr has_tail_v = has_tail<Index, Size>::value;
-
-    // tail
-    template< std::size_t Index
-            , std::size_t Size
-            , typename = std::enable_if_t<has_tail_v<Index, Size>>
-            >
-    struct tail {
-        static auto constexpr byte = (Index + Size) / 8;
-        static auto constexpr index = 0;
-        static auto constexpr size = (Index + Size) % 8;
+    template<>
+    struct load<1> {
+        template<typename Byte>
+        static std::uint64_t constexpr from(Byte const* bytes) {
+            return static_cast<std::uint8_t>(bytes[0]);
+        }
     };
 
-    // tail_b
-    template<std::size_t Index, std::size_t Size>
-    static auto constexpr tail_b = head<Index, Size>::byte;
-
-    // tail_i
-    template<std::size_t Index, std::size_t Size>
-    static auto constexpr tail_i = head<Index, Size>::index;
-
-    // head_s
-    template<std::size_t Index, std::size_t Size>
-    static auto constexpr tail_s = head<Index, Size>::size;
+    // big_endian, a native integer read as big-endian
+    inline std::uint64_t big_endian(std::uint64_t v) {
+#if defined(_MSC_VER)
+        return _byteswap_uint64(v);
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        return v;
+#else
+        return __builtin_bswap64(v);
+#endif
+    }
 
-    // has_waist
-    template< std::size_t Index
-            , std::size_t Size
-            , typename = std::enable_if_t<(Index >= 0 && Size > 0)>
+    // fetch, Count bytes as one big-endian integer, at run time
+    template< std::size_t Count
+            , typename = std::enable_if_t<(Count > 0 && Count <= 8)>
             >
-    struct has_waist {
-        static auto constexpr value = (cover_v<Index, Size>) > 2;
+    struct fetch {
+        template<typename Byte>
+        static std::uint64_t from(Byte const* bytes) {
+            static_assert(1 == sizeof(Byte), "bytes only");
+            std::uint64_t v = 0;
+            memcpy(&v, bytes, Count);
+            return big_endian(v) >> ((8 - Count) * 8);
+        }
     };
 
-    // has_waist_v
-    template<std::size_t Index, std::size_t Size>
-    static auto constexpr has_waist_v = has_waist<Index, Size>::value;
-
-    // partition
+    // field, bits Index .. Index + Size - 1 of a byte string
     template< std::size_t Index
             , std::size_t Size
-            , typename = std::enable_if_t<(Index >= 0 && Size > 0)>
-            >
-
-    template< std::size_t N
-            , std::size_t Index
-            , std::size_t Size
-            , std::size_t CoverIndex
-            , std::size_t CoverSize>
-    struct partition {
-    };
-
-    template< std::size_t N
-            , std::size_t Index
-            , std::size_t Size
-            , std::size_t CoverIndex
-            , std::size_t CoverSize>
-    struct partition<1> {
-
-    };
-
-    // spilt
-    template< std::size_t N
-            , std::size_t Index
-            , std::size_t Size
-            , typename = std::enable_if_t<( (N > 0)
-                                         && (Size > 0)
-                                         && (Index + Size < N)
-                                         )>
-            >
-    integer_t<Size> constexpr parse(std::array<std::uint8_t, N> const& bytes) {
-        bytes[]
-        auto constexpr cover_bytes = cover_v<N, Index, Size>;
-
-    }
-
-    // parse
-    template< std::size_t N
-            , std::size_t Index
-            , std::size_t Size
-            , typename = std::enable_if_t<( (N > 0)
-                                         && (Size > 0)
-                                         && (Index + Size < N)
+            , typename = std::enable_if_t<( Size > 0
+                                         && Index % 8 + Size <= 64
                                          )>
             >
-    integer_t<Size> constexpr parse(std::array<std::uint8_t, N> const& bytes) {
-        auto constexpr cover_bytes = cover_v<N, Index, Size>;
-        if (1 == cover_bytes) {
+    struct field {
+        static auto constexpr first = Index / 8;
+        static auto constexpr count = (Index + Size - 1) / 8 - first + 1;
+        static auto constexpr shift = count * 8 - Index % 8 - Size;
+        // bytes needed to hold the field
+        static auto constexpr end = first + count;
+        using type = integer_t<Size>;
+
+        template<typename Byte>
+        static type get(Byte const* bytes) {
+            return value(fetch<count>::from(bytes + first));
+        }
+        // the field out of the count bytes starting at first
+        static type constexpr value(std::uint64_t covered) {
+            return static_cast<type>((covered >> shift) & ones_v<Size>);
+        }
+    };
 
+    // bits, fields of an N byte string
+    template<std::size_t N>
+    struct bits {
+        template< std::size_t Index
+                , std::size_t Size
+                , typename T = integer_t<Size>
+                , typename = std::enable_if_t<(Index + Size <= N * 8)>
+                >
+        static T constexpr parse(std::array<std::uint8_t, N> const& bytes) {
+            using f = field<Index, Size>;
+            return static_cast<T>
+                   (f::value(load<f::count>::from(bytes.data() + f::first)));
         }
-    }
-    //
-#endif
+    };
 } // bit
 } // util
 
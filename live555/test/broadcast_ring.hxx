@@ -0,0 +1,262 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef BROADCAST_RING_HXX
+#define BROADCAST_RING_HXX
+
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+
+//
+// - Single-writer / multi-reader broadcast ring
+//    - Every element is stored once, however many readers there are; each
+//      reader owns nothing but its cursor.
+//    - The writer never waits for a reader. A reader that falls more than
+//      capacity() behind skips ahead to the newest keyframe still in the
+//      ring, or, if there is none, waits for the next one.
+//    - A slot points at a node holding the element. A reader pins the node
+//      with a count while it copies the handle out (one refcount bump for
+//      frames) and checks the slot still points at it. The writer fills a
+//      free node and swaps it in; a node it evicts while a reader holds it
+//      is left alone and another is taken, allocated if need be.
+//      contended() counts those evictions.
+//
+template<typename T>
+class broadcast_ring final {
+public:
+    using self_type = broadcast_ring<T>;
+    using value_type = T;
+    using size_type = std::size_t;
+    using seq_type = std::uint64_t;
+public:
+    static auto constexpr cache_line = std::size_t{64};
+    static auto constexpr npos = std::numeric_limits<seq_type>::max();
+public:
+    class reader final {
+    public:
+        reader() = default;
+        ~reader() = default;
+    private:
+        friend class broadcast_ring;
+        reader(broadcast_ring* ring, seq_type cursor, bool wait_key)
+            : ring_(ring)
+            , cursor_(cursor)
+            , wait_key_(wait_key) {
+            // EMPTY
+        }
+    public:
+        bool read(value_type& v) {
+            bool key = false;
+            return read(v, key);
+        }
+        // key is whether v was published as a keyframe
+        bool read(value_type& v, bool& key) {
+            if (nullptr == ring_) {
+                return false;
+            }
+            for (;;) {
+                auto const head = ring_->head_.load(std::memory_order_acquire);
+                if (cursor_ >= head) {
+                    return false;
+                }
+                if (head - cursor_ > ring_->capacity_) {
+                    overrun(head);
+                    continue;
+                }
+                if (!ring_->load(cursor_, v, key)) {
+                    // overwritten between the head check and the copy
+                    overrun(ring_->head_.load(std::memory_order_acquire));
+                    continue;
+                }
+                ++cursor_;
+                if (wait_key_ && !key) {
+                    skip(1);
+                    continue;
+                }
+                wait_key_ = false;
+                return true;
+            }
+        }
+        // false while the reader waits for a keyframe
+        bool synced() const {
+            return nullptr != ring_ && !wait_key_;
+        }
+        std::uint64_t skipped() const {
+            return skipped_;
+        }
+        std::size_t lag() const {
+            if (nullptr == ring_) {
+                return 0;
+            }
+            auto const head = ring_->head_.load(std::memory_order_acquire);
+            return head > cursor_ ? static_cast<std::size_t>(head - cursor_)
+                                  : 0;
+        }
+    private:
+        void overrun(seq_type head) {
+            auto const key = ring_->newest_key(head);
+            auto const to = (npos == key) ? head : key;
+            skip(to > cursor_ ? to - cursor_ : 0);
+            cursor_ = to;
+            wait_key_ = (npos == key);
+        }
+        void skip(std::uint64_t n) {
+            skipped_ += n;
+            ring_->skipped_.fetch_add(n, std::memory_order_relaxed);
+        }
+    private:
+        broadcast_ring* ring_ = nullptr;
+        seq_type cursor_ = 0;
+        bool wait_key_ = false;
+        std::uint64_t skipped_ = 0;
+    };
+public:
+    explicit broadcast_ring(size_type capacity)
+        : capacity_(0 == capacity ? 1 : capacity)
+        , slots_(new slot[capacity_]) {
+        // one per slot and a spare, more only while readers hold evicted ones
+        nodes_.reserve(capacity_ + 1);
+        free_.reserve(capacity_ + 1);
+        for (;nodes_.size() < capacity_ + 1;) {
+            nodes_.emplace_back(new node);
+            free_.push_back(nodes_.back().get());
+        }
+    }
+    ~broadcast_ring() = default;
+    broadcast_ring(broadcast_ring const&) = delete;
+    broadcast_ring& operator=(broadcast_ring const&) = delete;
+public:
+    size_type capacity() const {
+        return capacity_;
+    }
+    size_type size() const {
+        auto const head = head_.load(std::memory_order_acquire);
+        return static_cast<size_type>(head < capacity_ ? head : capacity_);
+    }
+    // elements skipped by all readers together
+    std::uint64_t skipped() const {
+        return skipped_.load(std::memory_order_relaxed);
+    }
+    // elements evicted while a reader still held them
+    std::uint64_t contended() const {
+        return contended_.load(std::memory_order_relaxed);
+    }
+public:
+    // writer side
+    void publish(value_type const& v, bool key) {
+        auto const seq = head_.load(std::memory_order_relaxed);
+        auto const n = take();
+        n->value = v;
+        n->key = key;
+        n->seq.store(seq, std::memory_order_relaxed);
+        auto const evicted = slots_[seq % capacity_].current.exchange(n);
+        if (nullptr != evicted) {
+            retire(evicted);
+        }
+        if (key) {
+            last_key_.store(seq, std::memory_order_release);
+        }
+        head_.store(seq + 1, std::memory_order_release);
+    }
+    // a reader starting on the newest keyframe still in the ring, or waiting
+    // for the next one
+    reader subscribe() {
+        auto const head = head_.load(std::memory_order_acquire);
+        auto const key = newest_key(head);
+        if (npos == key) {
+            return reader{this, head, true};
+        }
+        return reader{this, key, false};
+    }
+private:
+    seq_type newest_key(seq_type head) const {
+        auto const key = last_key_.load(std::memory_order_acquire);
+        if (npos == key || head - key > capacity_) {
+            return npos;
+        }
+        return key;
+    }
+    bool load(seq_type seq, value_type& v, bool& key) {
+        auto& s = slots_[seq % capacity_];
+        auto const n = s.current.load(std::memory_order_acquire);
+        if (nullptr == n) {
+            return false;
+        }
+        // pinned only if the writer has not evicted it since, see retire()
+        n->readers.fetch_add(1);
+        auto const ok = n == s.current.load()
+                     && seq == n->seq.load(std::memory_order_relaxed);
+        if (ok) {
+            v = n->value;
+            key = n->key;
+        }
+        n->readers.fetch_sub(1, std::memory_order_release);
+        return ok;
+    }
+private:
+    struct alignas(cache_line) node {
+        std::atomic<std::uint32_t> readers{0};
+        std::atomic<seq_type> seq{npos};
+        bool key = false;
+        value_type value;
+    };
+    struct alignas(cache_line) slot {
+        std::atomic<node*> current{nullptr};
+    };
+private:
+    // The evicted node is out of its slot before its readers are counted,
+    // so a reader that pins it afterwards sees another node in the slot and
+    // leaves it alone.
+    void retire(node* n) {
+        if (0 == n->readers.load()) {
+            n->value = value_type{};
+            free_.push_back(n);
+            return;
+        }
+        contended_.fetch_add(1, std::memory_order_relaxed);
+        held_.push_back(n);
+    }
+    node* take() {
+        for (std::size_t i = 0; i < held_.size(); ++i) {
+            if (0 == held_[i]->readers.load(std::memory_order_acquire)) {
+                free_.push_back(held_[i]);
+                held_[i] = held_.back();
+                held_.pop_back();
+                break;
+            }
+        }
+        if (free_.empty()) {
+            nodes_.emplace_back(new node);
+            return nodes_.back().get();
+        }
+        auto const n = free_.back();
+        free_.pop_back();
+        return n;
+    }
+private:
+    size_type const capacity_;
+    std::unique_ptr<slot[]> slots_;
+    // writer side only
+    std::vector<std::unique_ptr<node>> nodes_;
+    std::vector<node*> free_;
+    std::vector<node*> held_;
+private:
+    alignas(cache_line) std::atomic<seq_type> head_{0};
+    std::atomic<seq_type> last_key_{npos};
+    alignas(cache_line) std::atomic<std::uint64_t> skipped_{0};
+    std::atomic<std::uint64_t> contended_{0};
+};
+
+
+#endif // BROADCAST_RING_HXX
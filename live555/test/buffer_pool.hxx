@@ -0,0 +1,211 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef BUFFER_POOL_HXX
+#define BUFFER_POOL_HXX
+
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <new>
+
+
+//
+// - Size-class pool of refcounted byte blocks, the storage behind
+//   arrptr::pooled()
+//    - Classes are powers of two from 256 bytes (an ADTS frame) to 512 KiB
+//      (a large IDR picture); anything bigger goes straight to the heap.
+//    - A block carries its own atomic refcount and class in a header ahead
+//      of the bytes, so there is no control block and no deleter.
+//    - Each thread keeps a freelist per class. Frames are allocated by the
+//      pusher and released by the live555 thread, so a list that grows past
+//      its limit hands a batch to a shared depot and an empty one takes a
+//      batch back: one lock per batch, none per block.
+//    - Bytes are never zeroed, the caller is about to overwrite them.
+//
+class buffer_pool final {
+public:
+    using size_type = std::size_t;
+
+    struct alignas(std::max_align_t) block final {
+        std::atomic<std::uint32_t> refs;
+        std::uint32_t klass;
+        block* next;
+
+        char* data() {
+            return reinterpret_cast<char*>(this + 1);
+        }
+    };
+public:
+    static auto constexpr min_shift = size_type{8};
+    static auto constexpr max_shift = size_type{19};
+    static auto constexpr classes = max_shift - min_shift + 1;
+    static auto constexpr oversized = static_cast<std::uint32_t>(classes);
+    // bytes a thread keeps per class, and the depot per class
+    static auto constexpr cache_bytes = size_type{4} << 20;
+    static auto constexpr depot_bytes = size_type{32} << 20;
+public:
+    static size_type capacity(std::uint32_t klass) {
+        return size_type{1} << (min_shift + klass);
+    }
+    // blocks a thread keeps, between 4 and 64 whatever the class
+    static size_type cache_limit(std::uint32_t klass) {
+        auto const n = cache_bytes / capacity(klass);
+        return n < 4 ? 4 : (n > 64 ? 64 : n);
+    }
+    // blocks that move between a thread and the depot at once
+    static size_type batch_size(std::uint32_t klass) {
+        return cache_limit(klass) / 2;
+    }
+    static size_type depot_limit(std::uint32_t klass) {
+        auto const n = depot_bytes / capacity(klass);
+        return n < cache_limit(klass) ? cache_limit(klass) : n;
+    }
+    static std::uint32_t klass(size_type size) {
+        auto k = std::uint32_t{0};
+        for (; k < classes && capacity(k) < size; ++k) {
+            // EMPTY
+        }
+        return k;
+    }
+public:
+    // a block of at least size bytes holding one reference
+    static block* acquire(size_type size) {
+        auto const k = klass(size);
+        auto b = (k == oversized) ? nullptr : pop(k);
+        if (nullptr == b) {
+            auto const n = (k == oversized) ? size : capacity(k);
+            b = new (::operator new(sizeof(block) + n)) block{};
+            b->klass = k;
+        }
+        b->refs.store(1, std::memory_order_relaxed);
+        b->next = nullptr;
+        return b;
+    }
+    static void retain(block* b) {
+        b->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    // drops one reference, the last one puts the block back
+    static void release(block* b) {
+        if (1 != b->refs.fetch_sub(1, std::memory_order_acq_rel)) {
+            return;
+        }
+        if (b->klass == oversized) {
+            destroy(b);
+            return;
+        }
+        push(b);
+    }
+private:
+    struct list final {
+        block* head = nullptr;
+        size_type size = 0;
+
+        void push(block* b) {
+            b->next = head;
+            head = b;
+            ++size;
+        }
+        block* pop() {
+            auto const b = head;
+            head = b->next;
+            --size;
+            return b;
+        }
+        // moves up to n blocks from the head onto to
+        void move(list& to, size_type n) {
+            for (; 0 != n && nullptr != head; --n) {
+                to.push(pop());
+            }
+        }
+        void clear() {
+            for (; nullptr != head;) {
+                destroy(pop());
+            }
+        }
+    };
+
+    struct depot final {
+        std::mutex mutex;
+        list lists[classes];
+    };
+
+    // A thread's lists go to the depot when it exits; a block released
+    // after that, from another thread_local's destructor say, goes there
+    // directly.
+    struct cache final {
+        list lists[classes];
+
+        ~cache() {
+            gone() = true;
+            for (std::uint32_t k = 0; k < classes; ++k) {
+                give(lists[k], k, lists[k].size);
+            }
+        }
+    };
+private:
+    static void destroy(block* b) {
+        b->~block();
+        ::operator delete(b);
+    }
+    static depot& shared() {
+        // never destroyed, threads may still release blocks during exit
+        static auto const d = new depot{};
+        return *d;
+    }
+    static cache& local() {
+        static thread_local cache c;
+        return c;
+    }
+    static bool& gone() {
+        static thread_local bool g = false;
+        return g;
+    }
+    static block* pop(std::uint32_t k) {
+        if (gone()) {
+            return nullptr;
+        }
+        auto& l = local().lists[k];
+        if (nullptr == l.head) {
+            auto& d = shared();
+            std::lock_guard<std::mutex> lock{d.mutex};
+            d.lists[k].move(l, batch_size(k));
+        }
+        return nullptr == l.head ? nullptr : l.pop();
+    }
+    static void push(block* b) {
+        if (gone()) {
+            list l;
+            l.push(b);
+            give(l, b->klass, 1);
+            return;
+        }
+        auto& l = local().lists[b->klass];
+        l.push(b);
+        if (l.size > cache_limit(b->klass)) {
+            give(l, b->klass, batch_size(b->klass));
+        }
+    }
+    static void give(list& from, std::uint32_t k, size_type n) {
+        auto& d = shared();
+        auto kept = size_type{0};
+        {
+            std::lock_guard<std::mutex> lock{d.mutex};
+            auto const room = depot_limit(k) - d.lists[k].size;
+            kept = n < room ? n : room;
+            from.move(d.lists[k], kept);
+        }
+        list spill;
+        from.move(spill, n - kept);
+        spill.clear();
+    }
+};
+
+
+#endif // BUFFER_POOL_HXX
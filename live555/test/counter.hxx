@@ -0,0 +1,59 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef COUNTER_HXX
+#define COUNTER_HXX
+
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+
+
+//
+// - Monotonic counter written from many threads, summed when read
+//    - Every thread adds to its own cache line, picked once per thread, so
+//      event loops counting the same thing never bounce a line between
+//      cores. Threads beyond shards share lines, still correct.
+//    - value() walks all shards, it is meant for snapshots, not hot paths.
+//
+class counter final {
+public:
+    static auto constexpr shards = std::size_t{16};
+    static auto constexpr cache_line = std::size_t{64};
+public:
+    counter() = default;
+    ~counter() = default;
+    counter(counter const&) = delete;
+    counter& operator=(counter const&) = delete;
+public:
+    void add(std::uint64_t n = 1) {
+        cells_[shard()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+    std::uint64_t value() const {
+        std::uint64_t sum = 0;
+        for (auto const& c : cells_) {
+            sum += c.value.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+private:
+    static std::size_t shard() {
+        static std::atomic<std::size_t> next{0};
+        thread_local auto const s = next.fetch_add(1) % shards;
+        return s;
+    }
+private:
+    struct alignas(cache_line) cell {
+        std::atomic<std::uint64_t> value{0};
+    };
+private:
+    cell cells_[shards];
+};
+
+
+#endif // COUNTER_HXX
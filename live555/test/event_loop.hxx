@@ -0,0 +1,154 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef EVENT_LOOP_HXX
+#define EVENT_LOOP_HXX
+
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <BasicUsageEnvironment.hh>
+#include "./wakeup.hxx"
+
+#if defined(_WIN32)
+#   ifndef NOMINMAX
+#       define NOMINMAX
+#   endif
+#   include <windows.h>
+#elif defined(__linux__)
+#   include <pthread.h>
+#   include <sched.h>
+#endif
+
+
+//
+// - One live555 environment driven by its own thread
+//    - Everything created on env() must only be touched from the loop
+//      thread, post() and call() are the way in from anywhere else.
+//    - The thread may be pinned to a single CPU.
+//
+class event_loop final {
+public:
+    using task = std::function<void()>;
+public:
+    explicit event_loop(int cpu = -1)
+        : env_(create_env())
+        , wakeup_(wakeup::of(env_->taskScheduler())) {
+        thread_ = std::thread{&event_loop::thread_routine, this};
+        if (cpu >= 0) {
+            pin(cpu);
+        }
+    }
+    ~event_loop() {
+        stop();
+        auto const scheduler = &env_->taskScheduler();
+        wakeup_.reset();
+        env_->reclaim();
+        delete scheduler;
+    }
+    event_loop(event_loop const&) = delete;
+    event_loop& operator=(event_loop const&) = delete;
+public:
+    UsageEnvironment& env() const {
+        return *env_;
+    }
+    bool in_loop() const {
+        return std::this_thread::get_id() == thread_.get_id();
+    }
+    // runs t on the loop thread, some time later
+    void post(task const& t) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back(t);
+        }
+        wakeup_->post(&event_loop::on_tasks, this);
+    }
+    // runs t on the loop thread and waits for it
+    void call(task const& t) {
+        if (in_loop()) {
+            t();
+            return;
+        }
+        std::promise<void> done;
+        post([&t, &done]() {
+            t();
+            done.set_value();
+        });
+        done.get_future().wait();
+    }
+    void stop() {
+        if (!thread_.joinable()) {
+            return;
+        }
+        post([this]() {
+            event_looping_ = 1;
+        });
+        thread_.join();
+    }
+private:
+    static inline BasicUsageEnvironment* create_env() {
+        auto const scheduler = BasicTaskScheduler::createNew();
+        return BasicUsageEnvironment::createNew(*scheduler);
+    }
+    static void on_tasks(void* self) {
+        static_cast<event_loop*>(self)->run_tasks();
+    }
+private:
+    void thread_routine() {
+        env_->taskScheduler().doEventLoop(&event_looping_);
+    }
+    void run_tasks() {
+        std::vector<task> tasks;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks.swap(tasks_);
+        }
+        for (auto const& t : tasks) {
+            t();
+        }
+    }
+    bool pin(int cpu) {
+#if defined(_WIN32)
+        auto const mask = DWORD_PTR{1} << cpu;
+        if (0 == SetThreadAffinityMask(thread_.native_handle(), mask)) {
+            std::cerr << "thread affinity failed: " << cpu << std::endl;
+            return false;
+        }
+        return true;
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (0 != pthread_setaffinity_np( thread_.native_handle()
+                                       , sizeof(set)
+                                       , &set)) {
+            std::cerr << "thread affinity failed: " << cpu << std::endl;
+            return false;
+        }
+        return true;
+#else
+        (void)cpu;
+        return false;
+#endif
+    }
+private:
+    BasicUsageEnvironment* env_;
+    std::shared_ptr<wakeup> wakeup_;
+private:
+    char volatile event_looping_ = 0;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::vector<task> tasks_;
+};
+
+
+#endif // EVENT_LOOP_HXX
@@ -0,0 +1,149 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef FRAME_HXX
+#define FRAME_HXX
+
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <limits>
+#include <string>
+#include "./arrptr.hxx"
+
+
+//
+// - Immutable view into a refcounted backing buffer
+//    - Copying a frame only bumps the refcount of the backing buffer.
+//    - slice() hands out sub-ranges of the same allocation, so a producer can
+//      cut a whole file (or a whole pushed access unit) into frames without
+//      copying a single byte.
+//    - A frame may carry its capture PTS, the time it entered the server
+//      and whether it closes an access unit; slices keep all three.
+//
+class frame final {
+public:
+    using self_type = frame;
+    using buffer_type = arrptr<char>;
+    using size_type = std::size_t;
+    using clock = std::chrono::steady_clock;
+public:
+    static auto constexpr no_pts = std::numeric_limits<std::int64_t>::min();
+public:
+    static frame copy(char const* bytes, size_type size) {
+        if (nullptr == bytes || 0 == size) {
+            return frame{};
+        }
+        // every pushed NAL and ADTS frame comes through here, so the bytes
+        // go to a pooled block rather than a fresh heap array
+        auto buffer = buffer_type::pooled(size);
+        memcpy(buffer.ptr(), bytes, size);
+        return frame{buffer, 0, size};
+    }
+    static frame copy(std::string const& bytes) {
+        return copy(bytes.c_str(), bytes.size());
+    }
+public:
+    frame() = default;
+    ~frame() = default;
+    explicit frame(buffer_type const& buffer)
+        : frame(buffer, 0, buffer.size()) {
+        // EMPTY
+    }
+    frame(buffer_type const& buffer, size_type offset, size_type size)
+        : buffer_(buffer)
+        , offset_(fix_offset(buffer, offset))
+        , size_(fix_size(buffer, offset, size)) {
+        // EMPTY
+    }
+public:
+    char const* data() const {
+        return 0 == size_ ? nullptr : buffer_.ptr() + offset_;
+    }
+    size_type size() const {
+        return size_;
+    }
+    bool empty() const {
+        return 0 == size_;
+    }
+    char operator[](size_type i) const {
+        return data()[i];
+    }
+    explicit operator bool () const {
+        return !empty();
+    }
+    frame slice(size_type offset, size_type size) const {
+        if (offset > size_) {
+            return frame{};
+        }
+        auto const n = (size > size_ - offset) ? (size_ - offset) : size;
+        frame f{buffer_, offset_ + offset, n};
+        f.pts_ = pts_;
+        f.ingest_ = ingest_;
+        f.marker_ = marker_;
+        return f;
+    }
+    frame slice(size_type offset) const {
+        return slice(offset, size_);
+    }
+    buffer_type const& buffer() const {
+        return buffer_;
+    }
+    std::string str() const {
+        return empty() ? std::string{} : std::string{data(), size_};
+    }
+public:
+    // capture time on the pusher's media clock in microseconds, or no_pts
+    std::int64_t pts() const {
+        return pts_;
+    }
+    bool has_pts() const {
+        return no_pts != pts_;
+    }
+    // when the frame was captured or pushed, epoch if nobody said
+    clock::time_point ingest() const {
+        return ingest_;
+    }
+    frame& pts(std::int64_t us) {
+        pts_ = us;
+        return *this;
+    }
+    frame& ingest(clock::time_point t) {
+        ingest_ = t;
+        return *this;
+    }
+    // the last frame of an access unit, the RTP marker bit
+    bool marker() const {
+        return marker_;
+    }
+    frame& marker(bool m) {
+        marker_ = m;
+        return *this;
+    }
+private:
+    static size_type fix_offset(buffer_type const& buffer, size_type offset) {
+        return offset > buffer.size() ? buffer.size() : offset;
+    }
+    static size_type fix_size( buffer_type const& buffer
+                             , size_type offset
+                             , size_type size) {
+        auto const o = fix_offset(buffer, offset);
+        return size > buffer.size() - o ? buffer.size() - o : size;
+    }
+private:
+    buffer_type buffer_;
+    size_type offset_ = 0;
+    size_type size_ = 0;
+    std::int64_t pts_ = no_pts;
+    clock::time_point ingest_;
+    bool marker_ = false;
+};
+
+
+#endif // FRAME_HXX
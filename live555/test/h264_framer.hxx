@@ -0,0 +1,88 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef H264_FRAMER_HXX
+#define H264_FRAMER_HXX
+
+
+#include <cstdint>
+#include <H264VideoStreamFramer.hh>
+#include "./h264_source.hxx"
+#include "./h264_utils.hxx"
+
+
+//
+// - Discrete NAL framer in front of h264_source
+//    - h264_source already hands out single NALs without start codes, so no
+//      parser is created and nothing is scanned again; each NAL goes to the
+//      RTP sink as is, straight into the sink's buffer.
+//    - The marker bit comes from the frame metadata the pump recorded, not
+//      from guessing at the NAL type, so multi-slice pictures end right.
+//    - SPS / PPS passing through are kept for the SDP, as live555's own
+//      framers do.
+//
+class h264_framer final: public H264VideoStreamFramer {
+public:
+    static h264_framer* createNew(UsageEnvironment& env, h264_source* source) {
+        return new h264_framer(env, source);
+    }
+private:
+    h264_framer(UsageEnvironment& env, h264_source* source)
+        : H264VideoStreamFramer(env, source, False, False)
+        , source_(source) {
+        // EMPTY
+    }
+    virtual ~h264_framer() = default;
+private:
+    virtual void doGetNextFrame() override {
+        fInputSource->getNextFrame( fTo
+                                  , fMaxSize
+                                  , &h264_framer::after_getting
+                                  , this
+                                  , FramedSource::handleClosure
+                                  , this);
+    }
+    virtual void doStopGettingFrames() override {
+        // no parser to flush
+        FramedFilter::doStopGettingFrames();
+    }
+private:
+    static void after_getting( void* self
+                             , unsigned size
+                             , unsigned truncated
+                             , struct timeval pts
+                             , unsigned duration) {
+        static_cast<h264_framer*>(self)->after_getting( size
+                                                      , truncated
+                                                      , pts
+                                                      , duration);
+    }
+    void after_getting( unsigned size
+                      , unsigned truncated
+                      , struct timeval pts
+                      , unsigned duration) {
+        if (size > 0) {
+            auto const header = fTo[0];
+            if (h264_utils::is_sps(header)) {
+                saveCopyOfSPS(fTo, size);
+            } else if (h264_utils::is_pps(header)) {
+                saveCopyOfPPS(fTo, size);
+            }
+        }
+        fFrameSize = size;
+        fNumTruncatedBytes = truncated;
+        fPresentationTime = pts;
+        fDurationInMicroseconds = duration;
+        fPictureEndMarker = source_->marker() ? True : False;
+        FramedSource::afterGetting(this);
+    }
+private:
+    h264_source* source_;
+};
+
+
+#endif // H264_FRAMER_HXX
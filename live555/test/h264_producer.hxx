@@ -9,61 +9,45 @@
 #define H264_PRODUCER_HXX
 
 
-#include <atomic>
-#include <mutex>
+#include <cstdint>
 #include <memory>
-#include <condition_variable>
-#include <queue>
-#include <fstream>
-#include "h264_utils.hxx"
+#include <string>
+#include <vector>
+#include "./arrptr.hxx"
+#include "./frame.hxx"
+#include "./mapped_file.hxx"
+#include "./h264_utils.hxx"
 #include "./h264_pump.hxx"
+#include "./pacer.hxx"
 
 
 class h264_producer {
 public:
-    h264_producer(std::shared_ptr<h264_pump> const& pump)
-        : pump_(pump) {
-        std::ifstream ifs{"test.h264", std::ios::binary};
-        if (!ifs) {
+    h264_producer( std::shared_ptr<h264_pump> const& pump
+                 , std::string const& path = "test.h264"
+                 , unsigned fps = 25
+                 , pacer::time_point start = pacer::clock::now()
+                 , pacer& p = pacer::shared())
+        : pump_(pump)
+        , file_(mapped_file::map(path))
+        , pacer_(p) {
+        if (!file_) {
             return;
         }
-        ifs.seekg(0, std::ios::end);
-        auto const size = static_cast<std::size_t>(ifs.tellg());
-        ifs.seekg(0, std::ios::beg);
-
-        std::unique_ptr<char[]> buffer{new char[size]};
-        ifs.read(buffer.get(), size);
-
-        std::size_t i = 0;
-        std::size_t last = i;
-        for (;;) {
-            if (i > size - 4) {
-                break;
-            }
-            if (h264_utils::has_start_code(&buffer[i], 4)) {
-                if (0 != i) {
-                    auto const frame = std::string{&buffer[last], i - last};
-                    if (frame.size() > 4) {
-                        if (h264_utils::is_sps(frame[4])) {
-                            sps_ = frame.substr(4, frame.size() - 4);
-                        }
-                        else if (h264_utils::is_pps(frame[4])) {
-                            pps_ = frame.substr(4, frame.size() - 4);
-                        } else {
-                            frames_.emplace_back(frame);
-                        }
-                        last = i;
-                    }
-                }
-                i += 4;
-            } else {
-                ++i;
-            }
-        }
-
-        initialize_thread();
+        // captured once, before the pacer thread can touch the file
+        parameter_sets();
+        clock_ = pacer_.add( [this]() { return tick(); }
+                           , 1
+                           , 0 == fps ? 25 : fps
+                           , start);
+    }
+    ~h264_producer() {
+        pacer_.remove(clock_);
     }
 public:
+    pacer::jitter jitter() const {
+        return pacer_.stats(clock_);
+    }
     std::string sps() const {
         return sps_;
     }
@@ -71,46 +55,146 @@ public:
         return pps_;
     }
 private:
-    void thread_routine() {
-        if (frames_.empty()) {
-            return;
-        }
-        auto const size = frames_.size();
-        auto i = std::vector<std::string>::size_type{0};
-        for (;looping_;) {
-            if (size == i) {
-                i = 0;
+    // one access unit per tick, the NALs leading up to its picture and all
+    // of its slices, the last one marked; the pump gets the boundaries the
+    // index already has, the bytes are not scanned twice
+    bool tick() {
+        au_.clear();
+        au_nals_.clear();
+        auto picture = false;
+        frame nal;
+        for (;au_.size() < max_nals_per_tick && peek(nal);) {
+            auto const len = h264_utils::start_code_len(nal.data()
+                                                      , nal.size());
+            auto const header = static_cast<std::uint8_t>(nal[len]);
+            auto const first = len + 1 < nal.size()
+                             ? static_cast<std::uint8_t>(nal[len + 1])
+                             : std::uint8_t{0};
+            if (picture && h264_utils::begins_access_unit(header, first)) {
+                break;
             }
-            pump_->produce(frames_[i++]);
-            std::this_thread::sleep_for(std::chrono::milliseconds{38});
+            picture = picture || h264_utils::is_vcl(header);
+            au_.push_back(nal);
+            au_nals_.push_back(h264_utils::nal{ 0
+                                              , nal.size()
+                                              , h264_utils::get_nal_unit_type
+                                                        (header)
+                                              , static_cast<std::uint8_t>
+                                                        (len)});
+            peeked_ = false;
+        }
+        for (std::size_t i = 0; i < au_.size(); ++i) {
+            pump_->produce(au_[i], au_nals_[i], i + 1 == au_.size());
         }
+        return !au_.empty();
     }
-    bool initialize_thread() {
-        thread_ = std::thread{&h264_producer::thread_routine, this};
-        try {
-            thread_.detach();
-        } catch (std::exception const& e) {
-            std::cerr << "thread detach failed: "
-                      << e.what()
-                      << std::endl;
+    // the NAL next() would return, without taking it
+    bool peek(frame& nal) {
+        if (!peeked_) {
+            peeked_ = next(peeked_nal_);
+        }
+        nal = peeked_nal_;
+        return peeked_;
+    }
+    // The first pass scans lazily and records where the frames are, later
+    // passes replay that index. Pages behind the cursor are released.
+    bool next(frame& nal) {
+        if (next_ < index_.size()) {
+            auto const& e = index_[next_++];
+            nal = file_.slice(static_cast<std::size_t>(e.offset), e.size);
+            release(static_cast<std::size_t>(e.offset));
+            return true;
+        }
+        if (!indexed_ && index_next(nal)) {
+            ++next_;
+            release(scanned_);
+            return true;
+        }
+        indexed_ = true;
+        if (index_.empty()) {
             return false;
         }
-        return true;
+        next_ = 0;
+        released_ = 0;
+        return next(nal);
     }
+    // SPS / PPS lead the stream, scan just far enough to have them; they stay
+    // in the index and go out in-band as well.
+    void parameter_sets() {
+        auto const data = file_.data();
+        auto const size = file_.size();
+        auto offset = std::size_t{0};
+        for (;offset < size && (sps_.empty() || pps_.empty());) {
+            auto const n = h264_utils::next_nal(data, size, offset);
+            if (0 == n.size) {
+                break;
+            }
+            offset = n.offset + n.size;
+            if (n.size <= n.start_code_len) {
+                continue;
+            }
+            auto const found = file_.slice(n.offset, n.size);
+            if (h264_utils::is_sps(n.type)) {
+                sps_ = found.slice(n.start_code_len).str();
+            } else if (h264_utils::is_pps(n.type)) {
+                pps_ = found.slice(n.start_code_len).str();
+            }
+        }
+    }
+    bool index_next(frame& nal) {
+        auto const data = file_.data();
+        auto const size = file_.size();
+        for (;scanned_ < size;) {
+            auto const n = h264_utils::next_nal(data, size, scanned_);
+            if (0 == n.size) {
+                scanned_ = size;
+                break;
+            }
+            scanned_ = n.offset + n.size;
+            if (n.size <= n.start_code_len) {
+                continue;
+            }
+            index_.push_back(entry{ n.offset
+                                  , static_cast<std::uint32_t>(n.size)});
+            nal = file_.slice(n.offset, n.size);
+            return true;
+        }
+        indexed_ = true;
+        return false;
+    }
+    void release(std::size_t offset) {
+        if (offset < released_ + release_window * 2) {
+            return;
+        }
+        auto const to = offset - release_window;
+        mapped_file::release(file_.buffer(), released_, to - released_);
+        released_ = to;
+    }
+private:
+    struct entry {
+        std::uint64_t offset;
+        std::uint32_t size;
+    };
+private:
+    static auto constexpr release_window = std::size_t{4 * 1024 * 1024};
+    static auto constexpr max_nals_per_tick = std::size_t{64};
 private:
     std::shared_ptr<h264_pump> pump_;
-    std::vector<std::string> frames_;
+    frame file_;
+    std::vector<entry> index_;
+    std::vector<entry>::size_type next_ = 0;
+    std::size_t scanned_ = 0;
+    std::size_t released_ = 0;
+    bool indexed_ = false;
     std::string sps_;
     std::string pps_;
+    std::vector<frame> au_;
+    std::vector<h264_utils::nal> au_nals_;
+    frame peeked_nal_;
+    bool peeked_ = false;
 private:
-    std::atomic_bool looping_{true};
-    std::thread thread_;
-    std::mutex mutex_;
-    std::condition_variable cv_;
-
-    std::atomic_bool finished_{false};
-    std::condition_variable finish_cv_;
-    std::mutex efinish_mutex_;
+    pacer& pacer_;
+    pacer::id clock_ = 0;
 };
 
 
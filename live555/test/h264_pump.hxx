@@ -9,57 +9,198 @@
 #define H264_PUMP_HXX
 
 
-#include <mutex>
-#include <condition_variable>
-#include <queue>
-#include <iostream>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "./broadcast_ring.hxx"
+#include "./frame.hxx"
+#include "./histogram.hxx"
+#include "./h264_utils.hxx"
+#include "./latest_i.hxx"
+#include "./notifier.hxx"
+#include "./pump_stats.hxx"
+#include "./timeline.hxx"
 
 
 class h264_pump final {
 public:
-    h264_pump(unsigned fps, unsigned buffer_ms)
-        : buffer_size_(buffer_size(fps, buffer_ms)) {
+    using reader = broadcast_ring<frame>::reader;
+public:
+    h264_pump( unsigned fps
+             , unsigned buffer_ms
+             , std::shared_ptr<timeline> const& pts_timeline = nullptr)
+        : buffer_size_(buffer_size(fps, buffer_ms))
+        , frames_(buffer_size_)
+        , reader_(frames_.subscribe())
+        , timeline_(pts_timeline ? pts_timeline
+                                 : std::make_shared<timeline>()) {
     }
     ~h264_pump() = default;
 public:
-    bool produce(std::string const& frame) {
-        if (!mutex_.try_lock()) {
+    // f is one or more Annex-B NAL units; they are published one by one with
+    // the start code stripped, the last one marked when f closes an access
+    // unit. f is scanned for them here; a caller that has delimited its NAL
+    // already hands it over with the overload below instead.
+    // Only the first NAL of an access unit with an SPS or IDR is a key, so
+    // readers starting there get the AUD, parameter sets and every slice.
+    // The NALs ahead of the first slice are held until it arrives, or the
+    // unit closes, which is when that is known.
+    bool produce(frame const& f, bool closes = true) {
+        auto const g = stamped(f);
+        nals_.clear();
+        h264_utils::scan(g.data(), g.size(), nals_);
+        return publish(g, closes);
+    }
+    // f is the single NAL n describes, start code included, as a file or
+    // packet parser found it; the bytes are not scanned again
+    bool produce(frame const& f, h264_utils::nal const& n, bool closes) {
+        auto const g = stamped(f);
+        nals_.assign(1, n);
+        return publish(g, closes);
+    }
+    bool produce(std::string const& bytes) {
+        return produce(frame::copy(bytes));
+    }
+    // the pump's own reader, for a single consumer that did not subscribe()
+    bool consume(frame& packet) {
+        return reader_.read(packet);
+    }
+    // Every reader sees every frame; one that falls behind by more than
+    // buffer_size_ skips ahead to the newest keyframe.
+    reader subscribe() {
+        return frames_.subscribe();
+    }
+    // the newest SPS / PPS / IDR group, for readers that start unsynced
+    std::shared_ptr<latest_i::group_type const> latest_key() const {
+        return latest_i_.group();
+    }
+    // the PTS mapping shared by all pumps of one stream
+    std::shared_ptr<timeline> const& pts_timeline() const {
+        return timeline_;
+    }
+    // ingest to hand-off to the RTP sink, in microseconds
+    histogram& latency() {
+        return latency_;
+    }
+    // frames in, frames out per client
+    pump_stats& stats() {
+        return stats_;
+    }
+public:
+    // cb runs on the producer thread right after a frame became available
+    notifier::token attach(notifier::callback const& cb) {
+        return notifier_.attach(cb);
+    }
+    void detach(notifier::token t) {
+        notifier_.detach(t);
+    }
+public:
+    // frames evicted from the ring while a reader still held them
+    std::uint64_t contended() const {
+        return frames_.contended();
+    }
+    // the largest frame published so far, to size RTP sink buffers
+    std::size_t max_frame() const {
+        return max_frame_.load(std::memory_order_relaxed);
+    }
+    std::size_t size() const {
+        return frames_.size();
+    }
+    // frames skipped by all readers together
+    std::uint64_t dropped() const {
+        return frames_.skipped();
+    }
+private:
+    // frames nobody stamped entered the server just now
+    static frame stamped(frame const& f) {
+        if (frame::clock::time_point{} != f.ingest()) {
+            return f;
+        }
+        auto g = f;
+        return g.ingest(frame::clock::now());
+    }
+    // nals_ as found in g, the last marked when closes
+    bool publish(frame const& g, bool closes) {
+        auto last = nals_.size();
+        for (auto i = nals_.size(); i > 0; --i) {
+            if (nals_[i - 1].size > nals_[i - 1].start_code_len) {
+                last = i - 1;
+                break;
+            }
+        }
+        if (nals_.size() == last) {
             return false;
         }
-        if (frames_.size() > buffer_size_) {
-            auto empty = std::queue<std::string>{};
-            frames_.swap(empty);
+        for (std::size_t i = 0; i <= last; ++i) {
+            auto const& n = nals_[i];
+            if (n.size <= n.start_code_len) {
+                continue;
+            }
+            auto nal = g.slice(n.offset + n.start_code_len
+                              , n.size - n.start_code_len);
+            nal.marker(closes && i == last);
+            grow(nal.size());
+            stats_.produced(nal.size());
+            auto const types = h264_utils::type_bit(n.type);
+            latest_i_.update(nal, types);
+            if (sliced_) {
+                frames_.publish(nal, false);
+            } else {
+                lead_.push_back(nal);
+                lead_types_ |= types;
+                if (h264_utils::is_vcl(n.type) || nal.marker()) {
+                    publish_lead();
+                }
+            }
+            if (nal.marker()) {
+                sliced_ = false;
+            }
         }
-        frames_.push(frame);
-        mutex_.unlock();
-        std::this_thread::yield();
+        notifier_.notify();
         return true;
     }
-    bool consume(std::string& packet) {
-       if (!mutex_.try_lock()) {
-            return false;
+    // the NALs of an access unit up to its first slice, the first a key
+    // when any of them is an SPS or IDR
+    void publish_lead() {
+        auto const key = h264_utils::is_key(lead_types_);
+        for (std::size_t i = 0; i < lead_.size(); ++i) {
+            frames_.publish(lead_[i], key && 0 == i);
         }
-        if (frames_.empty()) {
-            mutex_.unlock();
-            std::this_thread::yield();
-            return false;
+        lead_.clear();
+        lead_types_ = 0;
+        sliced_ = true;
+    }
+    // single producer, a plain store is enough
+    void grow(std::size_t size) {
+        if (size > max_frame_.load(std::memory_order_relaxed)) {
+            max_frame_.store(size, std::memory_order_relaxed);
         }
-        packet = frames_.front();
-        frames_.pop();
-        mutex_.unlock();
-        return true;
     }
-private:
+    // the ring holds NALs, a picture usually travels with an AUD or SEI
     static inline unsigned buffer_size(unsigned fps, unsigned buffer_ms) {
         auto const ms_pre_frame = double{1000} / fps;
-        return static_cast<unsigned>(buffer_ms / ms_pre_frame);
+        return static_cast<unsigned>(buffer_ms / ms_pre_frame) * 2;
     }
 public:
     unsigned buffer_size_;
 private:
-    std::queue<std::string> frames_;
+    broadcast_ring<frame> frames_;
+    reader reader_;
+    notifier notifier_;
+    latest_i latest_i_;
+    std::vector<h264_utils::nal> nals_;
+    std::vector<frame> lead_;
+    std::uint32_t lead_types_ = 0;
+    // the current access unit's first slice went out
+    bool sliced_ = false;
 private:
-    std::mutex mutex_;
+    std::shared_ptr<timeline> timeline_;
+    histogram latency_;
+    pump_stats stats_;
+    std::atomic<std::size_t> max_frame_{0};
 };
 
 
@@ -13,10 +13,13 @@
 #include <cstdint>
 #include <string>
 #include <memory>
+#include <deque>
 #include <GroupsockHelper.hh>
 #include <FramedSource.hh>
+#include "./frame.hxx"
 #include "./h264_utils.hxx"
 #include "./h264_pump.hxx"
+#include "./wakeup.hxx"
 
 
 class h264_source final: public FramedSource {
@@ -26,56 +29,166 @@ public:
                , unsigned fps)
         : FramedSource(env)
         , pump_(pump)
-        , fps_(fps) {
+        , reader_(pump_->subscribe())
+        , client_(pump_->stats().attach())
+        , wakeup_(wakeup::of(env.taskScheduler()))
+        , fps_(0 == fps ? 25 : fps)
+        , usecs_pre_frame_(1000000 / fps_) {
+        // The ring no longer holds a keyframe, start from the cached one
+        // while the reader waits for the next.
+        if (!reader_.synced()) {
+            if (auto const key = pump_->latest_key()) {
+                replay_.assign(key->begin(), key->end());
+            }
+        }
+        auto const w = wakeup_;
+        token_ = pump_->attach([w, this]() {
+            w->post(&h264_source::on_data, this);
+        });
+    }
+    virtual ~h264_source() {
+        pump_->detach(token_);
+        wakeup_->cancel(this);
     }
-    virtual ~h264_source() = default;
 public:
     unsigned fps() const {
         return fps_;
     }
+    // the NAL handed out last closes its access unit
+    bool marker() const {
+        return marker_;
+    }
 private:
     virtual void doGetNextFrame() override {
-        std::string frame;
-        if (!pump_->consume(frame) && frame.size() < 7) {
-            schedule();
+        deliver();
+    }
+private:
+    static void on_data(void* self) {
+        auto const source = static_cast<h264_source*>(self);
+        if (source->isCurrentlyAwaitingData()) {
+            source->deliver();
+        }
+    }
+    void deliver() {
+        if (!pending_.empty()) {
+            fragment();
+            FramedSource::afterGetting(this);
             return;
         }
-        if (!check(frame)) {
-            schedule();
+        frame f;
+        for (;next(f);) {
+            if (!check(f)) {
+                continue;
+            }
+            pt(f);
+            get(f);
+            if (!replayed_) {
+                latency(f);
+            }
+            client_->behind(reader_.lag(), reader_.skipped());
+            FramedSource::afterGetting(this);
             return;
         }
-        get(frame);
-        pt();
-        schedule();
+        // Nothing buffered, the pump wakes us through on_data.
+    }
+    // a fresh source may start with the cached keyframe, then follows its
+    // own cursor into the pump
+    bool next(frame& f) {
+        replayed_ = !replay_.empty();
+        if (!replayed_) {
+            return reader_.read(f);
+        }
+        f = replay_.front();
+        replay_.pop_front();
+        return true;
     }
 private:
-    bool check(std::string const& frame) {
-        return h264_utils::has_start_code(frame);
+    // NALs arrive without their start code, see h264_pump::produce()
+    bool check(frame const& f) {
+        return !f.empty();
     }
-    void get(std::string const& frame) {
-        auto const data_size = frame.size();
-        fFrameSize = (data_size > fMaxSize) ? fMaxSize : data_size;
-        fNumTruncatedBytes = (data_size > fMaxSize) ? (data_size - fMaxSize)
-                                                    : 0;
-        memcpy(fTo, frame.c_str(), fFrameSize);
+    // A NAL larger than the sink's buffer would lose its tail, it is sent
+    // as FU-A fragments over the following calls instead.
+    void get(frame const& f) {
+        if (f.size() > fMaxSize && fMaxSize > fu_header_size) {
+            pending_ = f;
+            fragmented_ = 1;
+            client_->fragment();
+            fragment();
+            return;
+        }
+        fFrameSize = (f.size() > fMaxSize) ? fMaxSize : f.size();
+        fNumTruncatedBytes = f.size() - fFrameSize;
+        memcpy(fTo, f.data(), fFrameSize);
+        client_->sent(fFrameSize);
+        if (0 != fNumTruncatedBytes) {
+            client_->truncated(fNumTruncatedBytes);
+        }
     }
-    void pt() {
-        if (0 == fPresentationTime.tv_sec && 0 == fPresentationTime.tv_usec) {
+    // RFC 6184 5.8, the NAL header split into FU indicator and FU header.
+    // A fragment fits one RTP packet, so the sink's own fragmenter sends it
+    // untouched; the marker waits for the last one.
+    void fragment() {
+        auto const header = static_cast<std::uint8_t>(pending_[0]);
+        auto const room = (fMaxSize < max_fragment_size ? fMaxSize
+                                                        : max_fragment_size)
+                        - fu_header_size;
+        auto const left = pending_.size() - fragmented_;
+        auto const n = left > room ? room : left;
+        auto const first = 1 == fragmented_;
+        auto const last = n == left;
+        fTo[0] = static_cast<unsigned char>((header & 0xe0) | 28);
+        fTo[1] = static_cast<unsigned char>( (first ? 0x80 : 0)
+                                           | (last ? 0x40 : 0)
+                                           | (header & 0x1f));
+        memcpy(fTo + fu_header_size, pending_.data() + fragmented_, n);
+        fFrameSize = static_cast<unsigned>(fu_header_size + n);
+        fNumTruncatedBytes = 0;
+        client_->sent(fFrameSize);
+        fragmented_ += n;
+        marker_ = last && pending_.marker();
+        fDurationInMicroseconds = marker_ ? usecs_pre_frame_ : 0;
+        if (last) {
+            pending_ = frame{};
+        }
+    }
+    // the pushed PTS when there is one, else a steady fps cadence advanced
+    // once per access unit; only the closing NAL takes up time
+    void pt(frame const& f) {
+        if (f.has_pts()) {
+            fPresentationTime = pump_->pts_timeline()->map(f.pts(), f.ingest());
+        } else if (0 == fPresentationTime.tv_sec
+                   && 0 == fPresentationTime.tv_usec) {
             gettimeofday(&fPresentationTime, nullptr);
-        } else {
+        } else if (marker_) {
             unsigned uSeconds = fPresentationTime.tv_usec + usecs_pre_frame_;
             fPresentationTime.tv_sec += uSeconds / 1000000;
             fPresentationTime.tv_usec = uSeconds % 1000000;
         }
-        fDurationInMicroseconds = usecs_pre_frame_;
+        marker_ = f.marker();
+        fDurationInMicroseconds = marker_ ? usecs_pre_frame_ : 0;
     }
-    void schedule() {
-        auto& task = nextTask();
-        auto const f = reinterpret_cast<TaskFunc*>(FramedSource::afterGetting);
-        task = envir().taskScheduler().scheduleDelayedTask(0, f, this);
+    void latency(frame const& f) {
+        auto const since = frame::clock::now() - f.ingest();
+        auto const us = std::chrono::duration_cast<std::chrono::microseconds>
+                                (since).count();
+        pump_->latency().record(us < 0 ? 0 : static_cast<std::uint64_t>(us));
     }
 private:
     std::shared_ptr<h264_pump> pump_;
+    h264_pump::reader reader_;
+    std::shared_ptr<pump_stats::client> client_;
+    std::shared_ptr<wakeup> wakeup_;
+    notifier::token token_ = 0;
+    std::deque<frame> replay_;
+    bool replayed_ = false;
+    bool marker_ = false;
+    frame pending_;
+    std::size_t fragmented_ = 0;
+private:
+    // under the 1444 byte payload of a default live555 H.264 sink
+    static auto constexpr max_fragment_size = std::size_t{1400};
+    static auto constexpr fu_header_size = std::size_t{2};
 private:
     unsigned fps_;
     unsigned usecs_pre_frame_;
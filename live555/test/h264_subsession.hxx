@@ -12,11 +12,13 @@
 #include <string>
 #include <memory>
 #include <OnDemandServerMediaSubsession.hh>
-#include <H264VideoStreamFramer.hh>
 #include <H264VideoRTPSink.hh>
+#include "./batch_groupsock.hxx"
 #include "./h264_pump.hxx"
 #include "./h264_source.hxx"
+#include "./h264_framer.hxx"
 #include "./h264_sink.hxx"
+#include "./out_buffer.hxx"
 
 
 class h264_subsession final: public OnDemandServerMediaSubsession {
@@ -26,12 +28,14 @@ public:
                    , std::shared_ptr<h264_pump> const& pump
                    , unsigned fps
                    , std::string sps
-                   , std::string pps)
+                   , std::string pps
+                   , unsigned pacing_us = 0)
         : OnDemandServerMediaSubsession(env, reused)
         , pump_(pump)
         , fps_(fps)
         , sps_(sps)
-        , pps_(pps) {
+        , pps_(pps)
+        , pacing_us_(pacing_us) {
         // EMPTY
     }
     virtual ~h264_subsession() = default;
@@ -39,26 +43,34 @@ protected:
     virtual FramedSource* createNewStreamSource( unsigned
                                                , unsigned& bitrate) override {
         bitrate = 1024;
-        return H264VideoStreamFramer::createNew( envir()
-                                               , new h264_source( envir()
-                                                                , pump_
-                                                                , fps_)
-                                               , true);
+        return h264_framer::createNew( envir()
+                                     , new h264_source(envir(), pump_, fps_));
     }
     virtual RTPSink* createNewRTPSink( Groupsock* rtp
                                      , unsigned char rtp_payload_type_if_dynamic
                                      , FramedSource*) override {
+        // the fragmenter copies whole NALs, one byte after its header
+        out_buffer::reserve(pump_->max_frame() + 1);
         return new h264_sink( envir()
                             , rtp
                             , rtp_payload_type_if_dynamic
                             , sps_
                             , pps_);
     }
+    // RTP leaves an access unit at a time, RTCP on its odd port as before
+    virtual Groupsock* createGroupsock( struct in_addr const& addr
+                                      , Port port) override {
+        if (0 != (ntohs(port.num()) & 1)) {
+            return OnDemandServerMediaSubsession::createGroupsock(addr, port);
+        }
+        return new batch_groupsock(envir(), addr, port, pacing_us_);
+    }
 private:
     std::shared_ptr<h264_pump> pump_;
     unsigned fps_;
     std::string sps_;
     std::string pps_;
+    unsigned pacing_us_;
 };
 
 
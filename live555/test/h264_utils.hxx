@@ -9,38 +9,191 @@
 #define H264_UTILS_HXX
 
 
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <string>
 #include <array>
+#include <vector>
+
+#if defined(__AVX2__)
+#   include <immintrin.h>
+#   define H264_UTILS_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) \
+   || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define H264_UTILS_SSE2 1
+#endif
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#endif
 
 
 struct h264_utils {
     h264_utils() = delete;
     ~h264_utils() = delete;
 
+    // one NAL unit of an Annex-B byte stream, start code included
+    struct nal {
+        std::size_t offset;
+        std::size_t size;
+        std::uint8_t type;
+        std::uint8_t start_code_len;
+    };
+
     static bool has_start_code(std::string const& frame) {
-        if (frame.size() < 4) {
-            return false;
-        }
-        return 0 == memcmp( std::array<char, 4>{0x00, 0x00, 0x00, 0x01}.data()
-                          , frame.c_str()
-                          , 4);
+        return has_start_code(frame.c_str(), frame.size());
     }
 
     static bool has_start_code(char const* bytes, std::size_t size) {
-        if (size < 4) {
-            return false;
+        return 0 != start_code_len(bytes, size);
+    }
+
+    // 4 for 00 00 00 01, 3 for 00 00 01, 0 otherwise
+    static std::size_t start_code_len(char const* bytes, std::size_t size) {
+        auto const four = std::array<char, 4>{0x00, 0x00, 0x00, 0x01};
+        if (size >= 4 && 0 == memcmp(four.data(), bytes, 4)) {
+            return 4;
+        }
+        if (size >= 3 && 0 == memcmp(four.data() + 1, bytes, 3)) {
+            return 3;
+        }
+        return 0;
+    }
+
+    // offset of the first 00 00 01 in bytes, size if there is none
+    static std::size_t find_start_code(char const* bytes, std::size_t size) {
+        auto const u = reinterpret_cast<std::uint8_t const*>(bytes);
+        std::size_t i = 0;
+#if defined(H264_UTILS_AVX2) || defined(H264_UTILS_SSE2)
+        for (; i + lanes + 2 <= size; i += lanes) {
+            auto const mask = start_code_mask(u + i);
+            if (0 != mask) {
+                return i + lowest_bit(mask);
+            }
+        }
+#endif
+        // scalar, also the tail of the vector loop
+        for (; i + 3 <= size;) {
+            auto const c = u[i + 2];
+            if (c > 1) {
+                i += 3;
+            } else if (0 == c) {
+                ++i;
+            } else if (0 == u[i] && 0 == u[i + 1]) {
+                return i;
+            } else {
+                i += 3;
+            }
         }
-        return 0 == memcmp( std::array<char, 4>{0x00, 0x00, 0x00, 0x01}.data()
-                          , bytes
-                          , 4);
+        return size;
+    }
+
+    // the NAL unit behind the first start code at or after from,
+    // size is 0 if there is none
+    static nal next_nal( char const* bytes
+                       , std::size_t size
+                       , std::size_t from) {
+        auto const u = reinterpret_cast<std::uint8_t const*>(bytes);
+        auto const pos = from + find_start_code(bytes + from, size - from);
+        if (pos >= size) {
+            return nal{size, 0, 0, 0};
+        }
+        auto offset = pos;
+        std::uint8_t len = 3;
+        if (offset > from && 0 == u[offset - 1]) {
+            --offset;
+            len = 4;
+        }
+        auto const payload = pos + 3;
+        auto end = payload + find_start_code(bytes + payload, size - payload);
+        if (end < size && end > payload && 0 == u[end - 1]) {
+            --end;
+        }
+        auto const type = payload < size ? get_nal_unit_type(u[payload])
+                                         : std::uint8_t{0};
+        return nal{offset, end - offset, type, len};
+    }
+
+    // every NAL unit in bytes, in one pass
+    static std::vector<nal> scan(char const* bytes, std::size_t size) {
+        std::vector<nal> nals;
+        scan(bytes, size, nals);
+        return nals;
+    }
+
+    static void scan( char const* bytes
+                    , std::size_t size
+                    , std::vector<nal>& nals) {
+        auto const u = reinterpret_cast<std::uint8_t const*>(bytes);
+        auto pos = find_start_code(bytes, size);
+        std::size_t payload = 0;
+        for (; pos < size;) {
+            auto offset = pos;
+            std::uint8_t len = 3;
+            if (offset > payload && 0 == u[offset - 1]) {
+                --offset;
+                len = 4;
+            }
+            if (!nals.empty()) {
+                nals.back().size = offset - nals.back().offset;
+            }
+            payload = pos + 3;
+            auto const type = payload < size ? get_nal_unit_type(u[payload])
+                                             : std::uint8_t{0};
+            nals.push_back(nal{offset, size - offset, type, len});
+            pos = payload + find_start_code(bytes + payload, size - payload);
+        }
+    }
+
+    // bit t set for every NAL type t found in bytes
+    static std::uint32_t nal_types(char const* bytes, std::size_t size) {
+        auto const u = reinterpret_cast<std::uint8_t const*>(bytes);
+        std::uint32_t types = 0;
+        for (auto pos = find_start_code(bytes, size); pos + 3 < size;) {
+            types |= type_bit(get_nal_unit_type(u[pos + 3]));
+            auto const next = pos + 3;
+            pos = next + find_start_code(bytes + next, size - next);
+        }
+        return types;
+    }
+
+    static std::uint32_t constexpr type_bit(std::uint8_t type) {
+        return std::uint32_t{1} << type;
+    }
+
+    // bits of the types first..last
+    static std::uint32_t constexpr type_bits( std::uint8_t first
+                                            , std::uint8_t last) {
+        return (type_bit(last) | (type_bit(last) - 1)) & ~(type_bit(first) - 1);
+    }
+
+    static bool is_key(std::uint32_t types) {
+        return 0 != (types & (type_bit(5) | type_bit(7)));
     }
 
     static std::uint8_t get_nal_unit_type(std::uint8_t header) {
         return std::uint8_t{0x1f} & header;
     }
 
+    // coded slice, the NAL that closes an access unit's picture data
+    static bool is_vcl(std::uint8_t header) {
+        auto const type = get_nal_unit_type(header);
+        return type >= 1 && type <= 5;
+    }
+
+    // Whether a NAL following a coded slice opens the next access unit
+    // (7.4.1.2.3): an AUD, SEI, SPS, PPS or reserved 14..18 NAL, or a slice
+    // whose first_mb_in_slice is 0, the first bit of its payload set.
+    static bool begins_access_unit(std::uint8_t header, std::uint8_t next) {
+        auto const type = get_nal_unit_type(header);
+        if (is_vcl(header)) {
+            return 0 != (next & 0x80);
+        }
+        return 0 != ( type_bit(type)
+                    & (type_bits(6, 9) | type_bits(14, 18)));
+    }
+
     static bool is_idr(std::uint8_t header) {
         return std::uint8_t{0x05} == get_nal_unit_type(header);
     }
@@ -52,6 +205,44 @@ struct h264_utils {
     static bool is_pps(std::uint8_t header) {
         return std::uint8_t{0x08} == get_nal_unit_type(header);
     }
+private:
+    // bit i set when u[i], u[i + 1], u[i + 2] is 00 00 01
+#if defined(H264_UTILS_AVX2)
+    static std::size_t constexpr lanes = 32;
+    static inline std::uint32_t start_code_mask(std::uint8_t const* u) {
+        auto const load = [u](std::size_t i) -> __m256i {
+            return _mm256_loadu_si256(reinterpret_cast<__m256i const*>(u + i));
+        };
+        auto const zero = _mm256_setzero_si256();
+        auto const z0 = _mm256_cmpeq_epi8(load(0), zero);
+        auto const z1 = _mm256_cmpeq_epi8(load(1), zero);
+        auto const o2 = _mm256_cmpeq_epi8(load(2), _mm256_set1_epi8(1));
+        auto const hit = _mm256_and_si256(_mm256_and_si256(z0, z1), o2);
+        return static_cast<std::uint32_t>(_mm256_movemask_epi8(hit));
+    }
+#elif defined(H264_UTILS_SSE2)
+    static std::size_t constexpr lanes = 16;
+    static inline std::uint32_t start_code_mask(std::uint8_t const* u) {
+        auto const load = [u](std::size_t i) -> __m128i {
+            return _mm_loadu_si128(reinterpret_cast<__m128i const*>(u + i));
+        };
+        auto const zero = _mm_setzero_si128();
+        auto const z0 = _mm_cmpeq_epi8(load(0), zero);
+        auto const z1 = _mm_cmpeq_epi8(load(1), zero);
+        auto const o2 = _mm_cmpeq_epi8(load(2), _mm_set1_epi8(1));
+        auto const hit = _mm_and_si128(_mm_and_si128(z0, z1), o2);
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(hit));
+    }
+#endif
+    static inline unsigned lowest_bit(std::uint32_t mask) {
+#if defined(_MSC_VER)
+        unsigned long index = 0;
+        _BitScanForward(&index, mask);
+        return static_cast<unsigned>(index);
+#else
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+    }
 };
 
 
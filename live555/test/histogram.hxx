@@ -0,0 +1,118 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef HISTOGRAM_HXX
+#define HISTOGRAM_HXX
+
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#endif
+
+
+//
+// - Lock-free log-linear histogram of unsigned values (microseconds here)
+//    - Values below 16 are exact, above that every power of two is cut into
+//      16 buckets, so any percentile is off by at most 1/16 of its value.
+//    - record() is a couple of relaxed atomic adds, fine on a hot path.
+//
+class histogram final {
+public:
+    static auto constexpr sub_buckets = std::size_t{16};
+    static auto constexpr buckets = std::size_t{(64 - 3) * 16};
+public:
+    histogram() {
+        reset();
+    }
+    ~histogram() = default;
+    histogram(histogram const&) = delete;
+    histogram& operator=(histogram const&) = delete;
+public:
+    void record(std::uint64_t v) {
+        counts_[index(v)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(v, std::memory_order_relaxed);
+        auto max = max_.load(std::memory_order_relaxed);
+        for (;v > max && !max_.compare_exchange_weak(max, v);) {
+            // EMPTY
+        }
+    }
+    void reset() {
+        for (auto& c : counts_) {
+            c.store(0, std::memory_order_relaxed);
+        }
+        count_.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+public:
+    std::uint64_t count() const {
+        return count_.load(std::memory_order_relaxed);
+    }
+    std::uint64_t max() const {
+        return max_.load(std::memory_order_relaxed);
+    }
+    std::uint64_t mean() const {
+        auto const n = count();
+        return 0 == n ? 0 : sum_.load(std::memory_order_relaxed) / n;
+    }
+    // upper bound of the bucket holding the q-th quantile, q in [0, 1]
+    std::uint64_t percentile(double q) const {
+        auto const n = count();
+        if (0 == n) {
+            return 0;
+        }
+        auto const rank = static_cast<std::uint64_t>(q * (n - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < buckets; ++i) {
+            seen += counts_[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                auto const upper = lowest(i + 1) - 1;
+                return upper < max() ? upper : max();
+            }
+        }
+        return max();
+    }
+private:
+    static std::size_t index(std::uint64_t v) {
+        if (v < sub_buckets) {
+            return static_cast<std::size_t>(v);
+        }
+        auto const msb = highest_bit(v);
+        auto const sub = (v >> (msb - 4)) & (sub_buckets - 1);
+        return (msb - 3) * sub_buckets + static_cast<std::size_t>(sub);
+    }
+    // smallest value landing in bucket i
+    static std::uint64_t lowest(std::size_t i) {
+        if (i < sub_buckets) {
+            return i;
+        }
+        auto const msb = i / sub_buckets + 3;
+        auto const sub = i % sub_buckets;
+        return std::uint64_t{sub_buckets + sub} << (msb - 4);
+    }
+    static unsigned highest_bit(std::uint64_t v) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse64(&index, v);
+        return static_cast<unsigned>(index);
+#else
+        return 63u - static_cast<unsigned>(__builtin_clzll(v));
+#endif
+    }
+private:
+    std::atomic<std::uint64_t> counts_[buckets];
+    std::atomic<std::uint64_t> count_;
+    std::atomic<std::uint64_t> sum_;
+    std::atomic<std::uint64_t> max_;
+};
+
+
+#endif // HISTOGRAM_HXX
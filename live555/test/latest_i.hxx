@@ -5,37 +5,77 @@
 //
 
 
-#ifndef BITS_HXX
-#define BITS_HXX
+#ifndef LATEST_I_HXX
+#define LATEST_I_HXX
 
 
-#include <climits>
-#include <type_traits>
-#include <array>
 #include <cstdint>
+#include <memory>
+#include <vector>
+#include "./frame.hxx"
+#include "./h264_utils.hxx"
 
-template<std::size_t N, typename
-                      = std::enable_if_t<0 == N % sizeof(std::uint8_t)>
-        >
-struct bits {
-    bits() = delete;
-    ~bits() = delete;
-
-    template<std::size_t N
-
-    template< std::size_t I
-            , std::size_t S
-            , typename T = std::uint32_t
-            , typename = std::enable_if_t< std::is_integral<T>::value
-                                         && (S > 0)
-                                         && (I + S < sizeof(std::uint8_t) * N)
-                                         >
-            >
-    static inline T parse(std::array<uint8_t, N> const& bytes) {
-        return T{}
+
+//
+// - The newest SPS / PPS / IDR group of an H.264 stream
+//    - update() runs on the producer thread for every frame, classifying it
+//      by the NAL types it carries.
+//    - group() may be called from any thread; it is republished for every
+//      IDR slice so a multi-slice IDR is complete once its last slice went
+//      through.
+//
+class latest_i final {
+public:
+    using group_type = std::vector<frame>;
+public:
+    latest_i() = default;
+    ~latest_i() = default;
+    latest_i(latest_i const&) = delete;
+    latest_i& operator=(latest_i const&) = delete;
+public:
+    void update(frame const& f, std::uint32_t types) {
+        auto const idr = 0 != (types & h264_utils::type_bit(5));
+        auto const params = 0 != ( types & ( h264_utils::type_bit(7)
+                                           | h264_utils::type_bit(8)));
+        auto const slice = 0 != (types & h264_utils::type_bits(1, 4));
+        if (idr) {
+            if (closed_) {
+                idr_.clear();
+                closed_ = false;
+            }
+            if (params) {
+                // the access unit carries its own SPS / PPS
+                params_.clear();
+            }
+            idr_.push_back(f);
+            publish();
+            return;
+        }
+        if (params || slice) {
+            closed_ = true;
+        }
+        if (0 != (types & h264_utils::type_bit(7))) {
+            params_.clear();
+        }
+        if (params) {
+            params_.push_back(f);
+        }
+    }
+    std::shared_ptr<group_type const> group() const {
+        return std::atomic_load(&latest_);
     }
 private:
-    std::uint8_t* data_;
+    void publish() {
+        auto g = std::make_shared<group_type>(params_);
+        g->insert(g->end(), idr_.begin(), idr_.end());
+        std::atomic_store(&latest_, std::shared_ptr<group_type const>{g});
+    }
+private:
+    group_type params_;
+    group_type idr_;
+    bool closed_ = true;
+    std::shared_ptr<group_type const> latest_;
 };
 
-#endif // BITS_HXX
+
+#endif // LATEST_I_HXX
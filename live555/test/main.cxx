@@ -18,6 +18,7 @@
 #include "./h264_stream.hxx"
 
 #include "./stream.hxx"
+#include "./stream_server.hxx"
 
 #include "./on_demand_server.hxx"
 
@@ -32,7 +33,7 @@ public:
     }
     void thread_routine() {
         for (;looping_;) {
-            std::string packet;
+            frame packet;
             aac_pmp->consume(packet);
             std::this_thread::sleep_for(std::chrono::milliseconds{100});
         }
@@ -75,6 +76,8 @@ int main() {
     h264_producer h264_prd(h264_pmp);
 #endif
     stream s("mirror", 8854);
+    // ten second segments, the last six kept
+    s.record("recordings", std::chrono::seconds{10}, 6);
     s.start( 1
            , 4
            , 2
@@ -83,9 +86,41 @@ int main() {
            , 2000
            , 25);
     std::clog << "\n\nURL   "  << s.url() << std::endl;
+    metrics::shared().dump("metrics.json", std::chrono::seconds{5});
 
     std::this_thread::sleep_for(std::chrono::minutes{1});
     s.end();
+#elif 0
+    // multicast is looped back, a player on this host joins the group
+    multicast_group group;
+    group.address = "232.0.8.54";
+    group.port = 18854;
+    stream s("mirror", 8854);
+    s.start( 1
+           , 4
+           , 2
+           , 1080
+           , 720
+           , 2000
+           , 25
+           , group);
+    std::clog << "\n\nURL   "  << s.url() << std::endl;
+
+    std::this_thread::sleep_for(std::chrono::minutes{1});
+    s.end();
+#elif 0
+    h264_producer h264_prd(h264_pmp);
+    stream_server server(8854, 0, true);
+    auto const c = server.add( "mirror"
+                             , 1
+                             , 4
+                             , 2
+                             , 25
+                             , h264_prd.sps()
+                             , h264_prd.pps());
+    if (c) {
+        std::clog << "\n\nURL   "  << c->url() << std::endl;
+    }
 #else
     run_on_demand_server();
 #endif
@@ -0,0 +1,126 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef MAPPED_FILE_HXX
+#define MAPPED_FILE_HXX
+
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <iostream>
+#include "./arrptr.hxx"
+
+#if defined(_WIN32)
+#   ifndef NOMINMAX
+#       define NOMINMAX
+#   endif
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#endif
+
+
+//
+// - Read-only file mapping handed out as an arrptr<char>
+//    - The mapping goes away with the last arrptr (and so the last frame
+//      sliced out of it).
+//    - Pages are clean and file backed, release() drops a range of them
+//      from the resident set, touching the range again simply faults it
+//      back in from the file.
+//
+struct mapped_file {
+    mapped_file() = delete;
+    ~mapped_file() = delete;
+
+    static arrptr<char> map(std::string const& path) {
+#if defined(_WIN32)
+        auto const file = CreateFileA( path.c_str()
+                                     , GENERIC_READ
+                                     , FILE_SHARE_READ
+                                     , nullptr
+                                     , OPEN_EXISTING
+                                     , FILE_FLAG_SEQUENTIAL_SCAN
+                                     , nullptr);
+        if (INVALID_HANDLE_VALUE == file) {
+            return arrptr<char>::nil();
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || 0 == size.QuadPart) {
+            CloseHandle(file);
+            return arrptr<char>::nil();
+        }
+        auto const mapping = CreateFileMappingA( file
+                                               , nullptr
+                                               , PAGE_READONLY
+                                               , 0
+                                               , 0
+                                               , nullptr);
+        CloseHandle(file);
+        if (nullptr == mapping) {
+            return arrptr<char>::nil();
+        }
+        auto const view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (nullptr == view) {
+            return arrptr<char>::nil();
+        }
+        auto const unmap = [](char* ptr) {
+            UnmapViewOfFile(ptr);
+        };
+        return arrptr<char>{}.reset( static_cast<char*>(view)
+                                   , static_cast<std::size_t>(size.QuadPart)
+                                   , unmap);
+#else
+        auto const fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return arrptr<char>::nil();
+        }
+        struct stat st;
+        if (0 != ::fstat(fd, &st) || st.st_size <= 0) {
+            ::close(fd);
+            return arrptr<char>::nil();
+        }
+        auto const size = static_cast<std::size_t>(st.st_size);
+        auto const p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (MAP_FAILED == p) {
+            std::cerr << "mmap failed: " << path << std::endl;
+            return arrptr<char>::nil();
+        }
+        ::madvise(p, size, MADV_SEQUENTIAL);
+        auto const unmap = [size](char* ptr) {
+            ::munmap(ptr, size);
+        };
+        return arrptr<char>{}.reset(static_cast<char*>(p), size, unmap);
+#endif
+    }
+
+    static void release( arrptr<char> const& file
+                       , std::size_t offset
+                       , std::size_t size) {
+#if defined(_WIN32)
+        (void)file;
+        (void)offset;
+        (void)size;
+#else
+        auto const page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        auto const begin = (offset + page - 1) / page * page;
+        auto const end = (offset + size) / page * page;
+        if (!file || end <= begin || end > file.size()) {
+            return;
+        }
+        ::madvise(file.ptr() + begin, end - begin, MADV_DONTNEED);
+#endif
+    }
+};
+
+
+#endif // MAPPED_FILE_HXX
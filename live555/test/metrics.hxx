@@ -0,0 +1,188 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef METRICS_HXX
+#define METRICS_HXX
+
+
+#include <cstdint>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "../../cxx/json_file.hpp"
+#include "./aac_pump.hxx"
+#include "./h264_pump.hxx"
+#include "./histogram.hxx"
+#include "./pump_stats.hxx"
+
+
+//
+// - Registry of everything that can report numbers, snapshotted as JSON
+//    - Pumps, sources and sessions only bump counters; nothing is formatted
+//      until somebody asks for a snapshot.
+//    - add() registers a probe under a name, typically one per stream or
+//      channel; the probe runs on whatever thread takes the snapshot, so it
+//      must only read atomics. remove() returns once no snapshot is using
+//      the probe any more.
+//    - dump() writes a snapshot to disk every period from its own thread,
+//      through zbb::json_file::save_json (write to a temporary, rename).
+//
+class metrics final {
+public:
+    using json = nlohmann::json;
+    using probe = std::function<json()>;
+    using id = std::uint64_t;
+    using clock = std::chrono::system_clock;
+public:
+    static metrics& shared() {
+        static metrics m;
+        return m;
+    }
+public:
+    metrics() = default;
+    ~metrics() {
+        stop();
+    }
+    metrics(metrics const&) = delete;
+    metrics& operator=(metrics const&) = delete;
+public:
+    id add(std::string const& name, probe const& p) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        probes_[++last_id_] = entry{name, p};
+        return last_id_;
+    }
+    void remove(id i) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        probes_.erase(i);
+    }
+    // {"time": ms since epoch, "<name>": <probe>, ...}
+    json snapshot() const {
+        auto const now = std::chrono::duration_cast<std::chrono::milliseconds>
+                                 (clock::now().time_since_epoch()).count();
+        json j;
+        j["time"] = now;
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto const& p : probes_) {
+            j[p.second.name] = p.second.report();
+        }
+        return j;
+    }
+    bool save(std::string const& file) const {
+        return zbb::json_file::save_json(file, snapshot());
+    }
+    // replaces a running dump
+    void dump(std::string const& file, std::chrono::milliseconds period) {
+        stop();
+        std::lock_guard<std::mutex> lock(dump_mutex_);
+        dumping_ = true;
+        thread_ = std::thread{[this, file, period]() {
+            std::unique_lock<std::mutex> lock(dump_mutex_);
+            for (;!dump_cv_.wait_for( lock
+                                    , period
+                                    , [this]() { return !dumping_; });) {
+                lock.unlock();
+                if (!save(file)) {
+                    std::cerr << "metrics dump failed: " << file << std::endl;
+                }
+                lock.lock();
+            }
+        }};
+    }
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(dump_mutex_);
+            dumping_ = false;
+        }
+        dump_cv_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+public:
+    static json to_json(histogram const& h) {
+        return json{ {"count", h.count()}
+                   , {"mean", h.mean()}
+                   , {"p50", h.percentile(0.5)}
+                   , {"p90", h.percentile(0.9)}
+                   , {"p99", h.percentile(0.99)}
+                   , {"max", h.max()}};
+    }
+    static json to_json(pump_stats::client const& c) {
+        auto const seconds = std::chrono::duration<double>
+                                     (pump_stats::clock::now() - c.since())
+                                     .count();
+        auto const bps = seconds > 0 ? c.bytes() * 8 / seconds : 0.0;
+        return json{ {"id", c.id()}
+                   , {"frames", c.frames()}
+                   , {"bytes", c.bytes()}
+                   , {"bps", static_cast<std::uint64_t>(bps)}
+                   , {"lag", c.lag()}
+                   , {"skipped", c.skipped()}
+                   , {"truncated", c.truncated()}
+                   , {"fragmented", c.fragmented()}};
+    }
+    static json to_json(aac_pump& pump) {
+        return pump_json(pump);
+    }
+    static json to_json(h264_pump& pump) {
+        return pump_json(pump);
+    }
+    // the probe of one stream, it keeps both pumps alive
+    static probe of( std::shared_ptr<aac_pump> const& aac
+                   , std::shared_ptr<h264_pump> const& h264) {
+        return [aac, h264]() {
+            return json{{"aac", to_json(*aac)}, {"h264", to_json(*h264)}};
+        };
+    }
+private:
+    template<typename Pump>
+    static json pump_json(Pump& pump) {
+        auto& s = pump.stats();
+        auto clients = json::array();
+        for (auto const& c : s.clients()) {
+            clients.push_back(to_json(*c));
+        }
+        return json{ {"depth", pump.size()}
+                   , {"capacity", pump.buffer_size_}
+                   , {"dropped", pump.dropped()}
+                   , {"contended", pump.contended()}
+                   , {"max_frame", pump.max_frame()}
+                   , {"in", { {"frames", s.frames_in()}
+                            , {"bytes", s.bytes_in()}}}
+                   , {"out", { {"frames", s.frames_out()}
+                             , {"bytes", s.bytes_out()}
+                             , {"truncated", s.truncated()}
+                             , {"fragmented", s.fragmented()}}}
+                   , {"sources", s.sources()}
+                   , {"frame_size", to_json(s.sizes())}
+                   , {"latency", to_json(pump.latency())}
+                   , {"clients", clients}};
+    }
+private:
+    struct entry {
+        std::string name;
+        probe report;
+    };
+private:
+    mutable std::mutex mutex_;
+    std::map<id, entry> probes_;
+    id last_id_ = 0;
+private:
+    std::mutex dump_mutex_;
+    std::condition_variable dump_cv_;
+    bool dumping_ = false;
+    std::thread thread_;
+};
+
+
+#endif // METRICS_HXX
@@ -0,0 +1,196 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef MULTICAST_OUTPUT_HXX
+#define MULTICAST_OUTPUT_HXX
+
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <Groupsock.hh>
+#include <GroupsockHelper.hh>
+#include <PassiveServerMediaSubsession.hh>
+#include <RTCP.hh>
+#include "./aac_pump.hxx"
+#include "./aac_sink.hxx"
+#include "./aac_source.hxx"
+#include "./h264_framer.hxx"
+#include "./h264_pump.hxx"
+#include "./h264_sink.hxx"
+#include "./h264_source.hxx"
+#include "./out_buffer.hxx"
+
+
+//
+// - Where a multicast stream goes
+//    - An SSM group, 232.0.0.0/8; an empty address picks a random one.
+//    - port is the video RTP port, RTCP takes the next one and audio the two
+//      after that. A group without a port means unicast.
+//
+struct multicast_group final {
+    std::string address;
+    std::uint16_t port = 0;
+    std::uint8_t ttl = 16;
+
+    explicit operator bool () const {
+        return 0 != port;
+    }
+};
+
+//
+// - One RTP sink per track for every viewer of a stream
+//    - Each track is a source, a sink sending to the group and an RTCP
+//      instance, all created once. The sinks play as soon as they are added,
+//      whether anybody watches or not.
+//    - The tracks go into the session as PassiveServerMediaSubsessions, so
+//      RTSP DESCRIBE / SETUP hand out the group and ports instead of
+//      creating a sink per client; the session has to be an SSM one.
+//    - Multicast is looped back to the sending host, a client on the same
+//      machine receives it like any other.
+//    - Everything here belongs to the event loop of env.
+//
+class multicast_output final {
+public:
+    multicast_output(UsageEnvironment& env, multicast_group const& group)
+        : env_(env)
+        , group_(group) {
+        address_.s_addr = group_.address.empty()
+                        ? chooseRandomIPv4SSMAddress(env_)
+                        : our_inet_addr(group_.address.c_str());
+        gethostname(reinterpret_cast<char*>(cname_), sizeof(cname_) - 1);
+        cname_[sizeof(cname_) - 1] = '\0';
+    }
+    ~multicast_output() {
+        for (auto& t : tracks_) {
+            t->sink->stopPlaying();
+            Medium::close(t->rtcp);
+            Medium::close(t->sink);
+            Medium::close(t->source);
+        }
+    }
+    multicast_output(multicast_output const&) = delete;
+    multicast_output& operator=(multicast_output const&) = delete;
+public:
+    // dotted group address, for logs
+    std::string address() const {
+        return AddressString(address_).val();
+    }
+public:
+    bool add_h264( ServerMediaSession* session
+                 , std::shared_ptr<h264_pump> const& pump
+                 , unsigned fps
+                 , std::string const& sps
+                 , std::string const& pps) {
+        auto t = make_track(h264_port);
+        auto const source = new h264_source(env_, pump, fps);
+        t->source = h264_framer::createNew(env_, source);
+        // the fragmenter copies whole NALs, one byte after its header
+        out_buffer::reserve(pump->max_frame() + 1);
+        t->sink = new h264_sink( env_
+                               , t->rtp_socket.get()
+                               , h264_payload_type
+                               , sps
+                               , pps);
+        return add(session, std::move(t), h264_bandwidth);
+    }
+    bool add_aac( ServerMediaSession* session
+                , std::shared_ptr<aac_pump> const& pump
+                , std::uint8_t profile
+                , std::uint8_t sampling_frequency_index
+                , std::uint8_t channel_config
+                , unsigned max_frames = 1
+                , unsigned max_ms = 0) {
+        auto t = make_track(aac_port);
+        auto const source = new aac_source( env_
+                                          , pump
+                                          , profile
+                                          , sampling_frequency_index
+                                          , channel_config
+                                          , max_frames
+                                          , max_ms);
+        t->source = source;
+        out_buffer::reserve(pump->max_frame());
+        t->sink = new aac_sink( env_
+                              , t->rtp_socket.get()
+                              , aac_payload_type
+                              , source->sampling_frequency()
+                              , source->config()
+                              , source->channels()
+                              , source->aggregated());
+        return add(session, std::move(t), aac_bandwidth);
+    }
+private:
+    struct track final {
+        std::unique_ptr<Groupsock> rtp_socket;
+        std::unique_ptr<Groupsock> rtcp_socket;
+        FramedSource* source = nullptr;
+        RTPSink* sink = nullptr;
+        RTCPInstance* rtcp = nullptr;
+    };
+private:
+    std::unique_ptr<track> make_track(std::uint16_t offset) {
+        auto const port = static_cast<std::uint16_t>(group_.port + offset);
+        std::unique_ptr<track> t{new track{}};
+        auto const rtcp = static_cast<std::uint16_t>(port + 1);
+        t->rtp_socket.reset(new Groupsock( env_
+                                         , address_
+                                         , Port{port}
+                                         , group_.ttl));
+        t->rtcp_socket.reset(new Groupsock( env_
+                                          , address_
+                                          , Port{rtcp}
+                                          , group_.ttl));
+        t->rtp_socket->multicastSendOnly();
+        t->rtcp_socket->multicastSendOnly();
+        return t;
+    }
+    bool add( ServerMediaSession* session
+            , std::unique_ptr<track> t
+            , unsigned bandwidth) {
+        t->rtcp = RTCPInstance::createNew( env_
+                                         , t->rtcp_socket.get()
+                                         , bandwidth
+                                         , cname_
+                                         , t->sink
+                                         , nullptr
+                                         , True);
+        auto const ss = PassiveServerMediaSubsession::createNew( *t->sink
+                                                               , t->rtcp);
+        if (!session->addSubsession(ss)) {
+            std::cerr << "multicast subsession failed: " << address()
+                      << std::endl;
+            Medium::close(ss);
+            Medium::close(t->rtcp);
+            Medium::close(t->sink);
+            Medium::close(t->source);
+            return false;
+        }
+        t->sink->startPlaying(*t->source, nullptr, nullptr);
+        tracks_.push_back(std::move(t));
+        return true;
+    }
+private:
+    static auto constexpr h264_port = std::uint16_t{0};
+    static auto constexpr aac_port = std::uint16_t{2};
+    static auto constexpr h264_payload_type = std::uint8_t{96};
+    static auto constexpr aac_payload_type = std::uint8_t{97};
+    // kbps, for RTCP's share of the session
+    static auto constexpr h264_bandwidth = 1024u;
+    static auto constexpr aac_bandwidth = 128u;
+private:
+    UsageEnvironment& env_;
+    multicast_group const group_;
+    struct in_addr address_;
+    unsigned char cname_[101];
+    std::vector<std::unique_ptr<track>> tracks_;
+};
+
+
+#endif // MULTICAST_OUTPUT_HXX
@@ -0,0 +1,67 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef NOTIFIER_HXX
+#define NOTIFIER_HXX
+
+
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+
+//
+// - Data-arrival callbacks of a pump
+//    - notify() runs on the producer thread. The mutex is only ever contended
+//      by attach() / detach(), which happen once per source, and it makes
+//      sure no callback is running (or will run) once detach() returns.
+//
+class notifier final {
+public:
+    using callback = std::function<void()>;
+    using token = std::uint64_t;
+public:
+    notifier() = default;
+    ~notifier() = default;
+    notifier(notifier const&) = delete;
+    notifier& operator=(notifier const&) = delete;
+public:
+    token attach(callback const& cb) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto const t = ++next_;
+        callbacks_.emplace_back(t, cb);
+        return t;
+    }
+    void detach(token t) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto const match = [t](entry const& e) -> bool {
+            return t == e.first;
+        };
+        callbacks_.erase( std::remove_if( callbacks_.begin()
+                                        , callbacks_.end()
+                                        , match)
+                        , callbacks_.end());
+    }
+    void notify() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto const& e : callbacks_) {
+            e.second();
+        }
+    }
+private:
+    using entry = std::pair<token, callback>;
+private:
+    std::mutex mutex_;
+    std::vector<entry> callbacks_;
+    token next_ = 0;
+};
+
+
+#endif // NOTIFIER_HXX
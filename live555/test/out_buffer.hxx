@@ -0,0 +1,55 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef OUT_BUFFER_HXX
+#define OUT_BUFFER_HXX
+
+
+#include <cstddef>
+#include <mutex>
+#include <MediaSink.hh>
+
+
+//
+// - Sizing of live555's OutPacketBuffer
+//    - OutPacketBuffer::maxSize is one process-wide value. It is read
+//      whenever an RTP sink (or the H.264 fragmenter in front of it)
+//      allocates its buffer, and a frame larger than that is truncated.
+//    - reserve() is called with the largest frame a pump has seen right
+//      before a sink is created. maxSize is therefore a high-water mark over
+//      every stream of the process, not a per-stream size: a stream with
+//      small frames gets buffers sized for the largest stream seen so far.
+//      It grows in steps of twice the request rounded up to granularity, so
+//      a slowly growing keyframe does not step the size on every session.
+//    - Only this class writes maxSize, and the lock orders writers on
+//      different event loops. live555 reads it without the lock, so a sink
+//      built on another loop while it grows may still get the previous
+//      size. That size was enough for every frame seen before, and
+//      h264_source sends a NAL that does not fit as FU-A fragments.
+//
+struct out_buffer {
+    out_buffer() = delete;
+    ~out_buffer() = delete;
+
+    static auto constexpr granularity = std::size_t{64 * 1024};
+
+    // at least bytes fit, returns the size sinks created from now on get,
+    // on every stream
+    static std::size_t reserve(std::size_t bytes) {
+        static std::mutex mutex;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (bytes > OutPacketBuffer::maxSize) {
+            auto const want = (bytes * 2 + granularity - 1)
+                            / granularity * granularity;
+            OutPacketBuffer::maxSize = static_cast<unsigned>(want);
+        }
+        return OutPacketBuffer::maxSize;
+    }
+};
+
+
+#endif // OUT_BUFFER_HXX
@@ -0,0 +1,289 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef PACER_HXX
+#define PACER_HXX
+
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+//
+// - One thread driving any number of periodic clocks
+//    - The n-th tick of a clock is due at start + n * num / den seconds, an
+//      absolute deadline, so neither the callbacks' run time nor wakeup
+//      latency accumulates into drift.
+//    - Clocks sharing a start (the audio and video of one channel) stay in
+//      step for as long as they run.
+//    - Deadlines are kept in a hashed timing wheel of 1 ms slots, finding
+//      what is due costs the same with 2 clocks as with 2000.
+//    - The thread sleeps until the earliest deadline, looked up in the lap of
+//      the wheel ahead, and without a timeout while there is no clock.
+//    - Lateness of every tick is recorded per clock, see stats().
+//
+class pacer final {
+public:
+    using clock = std::chrono::steady_clock;
+    using time_point = clock::time_point;
+    using id = std::uint64_t;
+    // false ends the clock
+    using tick = std::function<bool()>;
+public:
+    struct jitter {
+        std::uint64_t ticks = 0;
+        std::uint64_t skipped = 0;
+        std::int64_t max_ns = 0;
+        std::int64_t sum_ns = 0;
+
+        std::int64_t mean_ns() const {
+            return 0 == ticks ? 0 : sum_ns / static_cast<std::int64_t>(ticks);
+        }
+    };
+public:
+    static pacer& shared() {
+        static pacer p;
+        return p;
+    }
+public:
+    pacer()
+        : slots_(wheel_size)
+        , cursor_(slot_of(clock::now())) {
+        thread_ = std::thread{&pacer::thread_routine, this};
+    }
+    ~pacer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            looping_ = false;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+    pacer(pacer const&) = delete;
+    pacer& operator=(pacer const&) = delete;
+public:
+    // t runs every num / den seconds from start on, first at start
+    id add( tick const& t
+          , std::uint64_t num
+          , std::uint64_t den
+          , time_point start = clock::now()) {
+        if (0 == num || 0 == den) {
+            return 0;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto const i = ++last_id_;
+        auto& c = clocks_[i];
+        c.t = t;
+        c.num = num;
+        c.den = den;
+        c.start = start;
+        schedule(i, c);
+        cv_.notify_all();
+        return i;
+    }
+    // once remove() returns the clock's tick will not run again
+    void remove(id i) {
+        if (0 == i) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        clocks_.erase(i);
+        if (std::this_thread::get_id() == thread_.get_id()) {
+            return;
+        }
+        auto const idle = [this, i]() -> bool {
+            return firing_ != i;
+        };
+        cv_.wait(lock, idle);
+    }
+    jitter stats(id i) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto const c = clocks_.find(i);
+        return clocks_.end() == c ? jitter{} : c->second.stats;
+    }
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return clocks_.size();
+    }
+private:
+    struct clock_state {
+        tick t;
+        std::uint64_t num = 1;
+        std::uint64_t den = 1;
+        time_point start;
+        std::uint64_t n = 0;
+        jitter stats;
+
+        time_point deadline() const {
+            auto const whole = n * num / den;
+            auto const part = n * num % den;
+            auto const ns = whole * 1000000000ull + part * 1000000000ull / den;
+            return start + std::chrono::duration_cast<clock::duration>
+                                    (std::chrono::nanoseconds{ns});
+        }
+        std::chrono::nanoseconds period() const {
+            return std::chrono::nanoseconds{num * 1000000000ull / den};
+        }
+    };
+    struct due {
+        time_point deadline;
+        id i;
+
+        bool operator<(due const& other) const {
+            return deadline < other.deadline;
+        }
+    };
+private:
+    static std::uint64_t slot_of(time_point t) {
+        auto const ms = std::chrono::duration_cast<std::chrono::milliseconds>
+                                (t.time_since_epoch());
+        return static_cast<std::uint64_t>(ms.count());
+    }
+private:
+    // a deadline already behind the sweep goes to the slot swept next
+    void schedule(id i, clock_state const& c) {
+        auto const k = std::max(slot_of(c.deadline()), cursor_);
+        slots_[k % wheel_size].push_back(i);
+    }
+    void thread_routine() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        std::vector<due> ready;
+        for (;looping_;) {
+            auto const now = clock::now();
+            auto const current = slot_of(now);
+            // a full lap visits every slot, that is all there is to sweep
+            if (current - cursor_ > wheel_size) {
+                cursor_ = current - wheel_size;
+            }
+            for (;cursor_ < current; ++cursor_) {
+                sweep(cursor_, now, ready);
+            }
+            sweep(current, now, ready);
+            std::sort(ready.begin(), ready.end());
+            for (auto const& d : ready) {
+                fire(d, lock);
+            }
+            ready.clear();
+            auto wake = time_point{};
+            if (wake_at(current, wake)) {
+                cv_.wait_until(lock, wake);
+            } else {
+                cv_.wait(lock);
+            }
+        }
+    }
+    // moves what is due from slot k to ready, keeps the rest for later laps
+    void sweep(std::uint64_t k, time_point now, std::vector<due>& ready) {
+        auto& slot = slots_[k % wheel_size];
+        auto kept = std::size_t{0};
+        for (auto const i : slot) {
+            auto const c = clocks_.find(i);
+            if (clocks_.end() == c) {
+                continue;
+            }
+            auto const deadline = c->second.deadline();
+            if (deadline <= now) {
+                ready.push_back(due{deadline, i});
+            } else {
+                slot[kept++] = i;
+            }
+        }
+        slot.resize(kept);
+    }
+    void fire(due const& d, std::unique_lock<std::mutex>& lock) {
+        auto c = clocks_.find(d.i);
+        if (clocks_.end() == c) {
+            return;
+        }
+        auto const t = c->second.t;
+        auto const late = clock::now() - d.deadline;
+        firing_ = d.i;
+        lock.unlock();
+        auto const more = t();
+        lock.lock();
+        firing_ = 0;
+        cv_.notify_all();
+        c = clocks_.find(d.i);
+        if (clocks_.end() == c) {
+            return;
+        }
+        if (!more) {
+            clocks_.erase(c);
+            return;
+        }
+        auto& s = c->second;
+        auto const ns = std::chrono::duration_cast<std::chrono::nanoseconds>
+                                (late).count();
+        ++s.stats.ticks;
+        s.stats.sum_ns += ns;
+        s.stats.max_ns = std::max(s.stats.max_ns, ns);
+        ++s.n;
+        // Hopelessly behind (a suspended machine, a stalled callback), give
+        // up on the missed ticks rather than bursting them out.
+        auto const behind = clock::now() - s.deadline();
+        if (behind > s.period() * max_behind) {
+            auto const missed = static_cast<std::uint64_t>
+                                        (behind / s.period());
+            s.n += missed;
+            s.stats.skipped += missed;
+        }
+        schedule(d.i, s);
+    }
+    // The earliest deadline of the first slot ahead holding one for this
+    // lap, else the end of the lap; false when there is no clock at all.
+    bool wake_at(std::uint64_t current, time_point& wake) const {
+        if (clocks_.empty()) {
+            return false;
+        }
+        for (auto k = current; k < current + wheel_size; ++k) {
+            auto found = false;
+            for (auto const i : slots_[k % wheel_size]) {
+                auto const c = clocks_.find(i);
+                if (clocks_.end() == c) {
+                    continue;
+                }
+                auto const deadline = c->second.deadline();
+                if (slot_of(deadline) > k) {
+                    continue;
+                }
+                wake = found ? std::min(wake, deadline) : deadline;
+                found = true;
+            }
+            if (found) {
+                return true;
+            }
+        }
+        wake = time_point{std::chrono::duration_cast<clock::duration>
+                                (std::chrono::milliseconds{current
+                                                           + wheel_size})};
+        return true;
+    }
+private:
+    static auto constexpr wheel_size = std::uint64_t{1024};
+    static auto constexpr max_behind = 8;
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::map<id, clock_state> clocks_;
+    std::vector<std::vector<id>> slots_;
+    std::uint64_t cursor_;
+    id last_id_ = 0;
+    id firing_ = 0;
+    bool looping_ = true;
+    std::thread thread_;
+};
+
+
+#endif // PACER_HXX
@@ -0,0 +1,191 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef PUMP_STATS_HXX
+#define PUMP_STATS_HXX
+
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "./counter.hxx"
+#include "./histogram.hxx"
+
+
+//
+// - Traffic through one pump, in on the producer side and out per client
+//    - The producer counts what it publishes; every source attach()es a
+//      client and counts what it hands to its RTP sink. The totals over all
+//      clients are sharded counters, the event loops add to them in
+//      parallel.
+//    - A client is written by its own event loop only, its fields are
+//      relaxed atomics so a snapshot may read them from any thread.
+//    - clients() lists the clients still alive.
+//
+class pump_stats final {
+public:
+    using clock = std::chrono::steady_clock;
+public:
+    class client final {
+    private:
+        friend class pump_stats;
+        client(pump_stats& stats, std::uint64_t id)
+            : stats_(stats)
+            , id_(id)
+            , since_(clock::now()) {
+            // EMPTY
+        }
+    public:
+        ~client() = default;
+        client(client const&) = delete;
+        client& operator=(client const&) = delete;
+    public:
+        // bytes handed to the RTP sink as one frame
+        void sent(std::size_t bytes) {
+            add(frames_, 1);
+            add(bytes_, bytes);
+            stats_.frames_out_.add();
+            stats_.bytes_out_.add(bytes);
+        }
+        void truncated(std::size_t bytes) {
+            add(truncated_, bytes);
+            stats_.truncated_.add(bytes);
+        }
+        // a frame sent in pieces
+        void fragment() {
+            add(fragmented_, 1);
+            stats_.fragmented_.add();
+        }
+        // how far the client's reader is behind, and what it skipped so far
+        void behind(std::size_t lag, std::uint64_t skipped) {
+            lag_.store(lag, std::memory_order_relaxed);
+            skipped_.store(skipped, std::memory_order_relaxed);
+        }
+    public:
+        std::uint64_t id() const {
+            return id_;
+        }
+        clock::time_point since() const {
+            return since_;
+        }
+        std::uint64_t frames() const {
+            return frames_.load(std::memory_order_relaxed);
+        }
+        std::uint64_t bytes() const {
+            return bytes_.load(std::memory_order_relaxed);
+        }
+        std::uint64_t truncated() const {
+            return truncated_.load(std::memory_order_relaxed);
+        }
+        std::uint64_t fragmented() const {
+            return fragmented_.load(std::memory_order_relaxed);
+        }
+        std::uint64_t lag() const {
+            return lag_.load(std::memory_order_relaxed);
+        }
+        std::uint64_t skipped() const {
+            return skipped_.load(std::memory_order_relaxed);
+        }
+    private:
+        // single writer, no read-modify-write needed
+        static void add(std::atomic<std::uint64_t>& a, std::uint64_t n) {
+            a.store(a.load(std::memory_order_relaxed) + n
+                   , std::memory_order_relaxed);
+        }
+    private:
+        pump_stats& stats_;
+        std::uint64_t const id_;
+        clock::time_point const since_;
+        std::atomic<std::uint64_t> frames_{0};
+        std::atomic<std::uint64_t> bytes_{0};
+        std::atomic<std::uint64_t> truncated_{0};
+        std::atomic<std::uint64_t> fragmented_{0};
+        std::atomic<std::uint64_t> lag_{0};
+        std::atomic<std::uint64_t> skipped_{0};
+    };
+public:
+    pump_stats() = default;
+    ~pump_stats() = default;
+    pump_stats(pump_stats const&) = delete;
+    pump_stats& operator=(pump_stats const&) = delete;
+public:
+    // producer side, once per published frame
+    void produced(std::size_t bytes) {
+        frames_in_.add();
+        bytes_in_.add(bytes);
+        sizes_.record(bytes);
+    }
+    // a new source, it keeps the client for as long as it lives
+    std::shared_ptr<client> attach() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sources_.add();
+        std::shared_ptr<client> c{new client{*this, ++last_id_}};
+        clients_.push_back(c);
+        return c;
+    }
+    std::vector<std::shared_ptr<client const>> clients() {
+        std::vector<std::shared_ptr<client const>> alive;
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto i = clients_.begin();
+        for (;clients_.end() != i;) {
+            if (auto c = i->lock()) {
+                alive.push_back(c);
+                ++i;
+            } else {
+                i = clients_.erase(i);
+            }
+        }
+        return alive;
+    }
+public:
+    std::uint64_t frames_in() const {
+        return frames_in_.value();
+    }
+    std::uint64_t bytes_in() const {
+        return bytes_in_.value();
+    }
+    std::uint64_t frames_out() const {
+        return frames_out_.value();
+    }
+    std::uint64_t bytes_out() const {
+        return bytes_out_.value();
+    }
+    std::uint64_t truncated() const {
+        return truncated_.value();
+    }
+    std::uint64_t fragmented() const {
+        return fragmented_.value();
+    }
+    // sources ever attached
+    std::uint64_t sources() const {
+        return sources_.value();
+    }
+    // published frame sizes in bytes
+    histogram const& sizes() const {
+        return sizes_;
+    }
+private:
+    counter frames_in_;
+    counter bytes_in_;
+    counter frames_out_;
+    counter bytes_out_;
+    counter truncated_;
+    counter fragmented_;
+    counter sources_;
+    histogram sizes_;
+private:
+    std::mutex mutex_;
+    std::vector<std::weak_ptr<client>> clients_;
+    std::uint64_t last_id_ = 0;
+};
+
+
+#endif // PUMP_STATS_HXX
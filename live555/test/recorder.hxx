@@ -0,0 +1,441 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef RECORDER_HXX
+#define RECORDER_HXX
+
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "./aac_pump.hxx"
+#include "./frame.hxx"
+#include "./h264_pump.hxx"
+
+
+//
+// - Tee of pumps to rolling segments on disk, for time-shift and audit
+//    - Every track is a reader of its pump's ring, like any RTP source. The
+//      producer is never told about it: the I/O thread polls the readers
+//      every tick, and one that falls behind the ring skips ahead just like
+//      a slow client would, counted in dropped().
+//    - Frames are not copied. They are held until the bytes went out in one
+//      pwritev() per track and batch, a batch being write_size bytes or
+//      whatever a track gathered during flush_period.
+//    - A segment is a plain elementary stream: Annex-B H.264 (start codes
+//      put back) or ADTS, playable as is. A new one starts every segment
+//      length, and the oldest go once more than keep exist. An H.264 segment
+//      starts on the first NAL of a keyframe's access unit, the pump's key,
+//      so the AUD or SEI ahead of the IDR go with it, and the channel's
+//      SPS / PPS are written in front since pushers send them out of band.
+//    - Next to every segment an .idx file (name.h264.idx) lists seek points as
+//      index_entry records: each H.264 keyframe and one ADTS packet per
+//      second, with the pushed PTS, the wall clock time of ingest and the
+//      byte offset in the segment.
+//    - POSIX only, like the rest of the file I/O done from a thread here.
+//
+class recorder final {
+public:
+    using clock = frame::clock;
+    using id = std::uint64_t;
+
+    // native endian, 24 bytes, no padding
+    struct index_entry final {
+        std::int64_t pts;       // frame::no_pts when nobody pushed one
+        std::int64_t time_us;   // unix time of ingest, microseconds
+        std::uint64_t offset;   // of the seek point in the segment
+    };
+    static_assert(24 == sizeof(index_entry), "index_entry is on disk");
+public:
+    explicit recorder( std::string const& dir
+                     , std::chrono::seconds segment = std::chrono::seconds{60}
+                     , std::size_t keep = 0)
+        : dir_(dir)
+        , segment_(segment < std::chrono::seconds{1} ? std::chrono::seconds{1}
+                                                     : segment)
+        , keep_(keep) {
+        std::error_code ec;
+        std::filesystem::create_directories(dir_, ec);
+        if (ec) {
+            std::cerr << "recorder: " << dir_ << ": " << ec.message()
+                      << std::endl;
+            return;
+        }
+        working_ = true;
+        thread_ = std::thread{&recorder::thread_routine, this};
+    }
+    ~recorder() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            working_ = false;
+        }
+        cv_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        for (auto& t : tracks_) {
+            close(*t);
+        }
+        for (auto& t : closing_) {
+            close(*t);
+        }
+    }
+    recorder(recorder const&) = delete;
+    recorder& operator=(recorder const&) = delete;
+public:
+    bool available() const {
+        return thread_.joinable();
+    }
+    // name becomes the file name prefix, slashes turned into underscores;
+    // sps / pps are the raw NALs the subsession announces, either may be
+    // empty when the stream carries them in-band
+    id add( std::string const& name
+          , std::shared_ptr<h264_pump> const& pump
+          , std::string const& sps
+          , std::string const& pps) {
+        auto t = std::make_shared<track>(name, pump->subscribe(), true);
+        for (auto const nal : {&sps, &pps}) {
+            if (!nal->empty()) {
+                t->parameter_sets.append(start_code, sizeof(start_code));
+                t->parameter_sets += *nal;
+            }
+        }
+        return add(t);
+    }
+    id add(std::string const& name, std::shared_ptr<aac_pump> const& pump) {
+        return add(std::make_shared<track>(name, pump->subscribe(), false));
+    }
+    // what was gathered is still written, then the segment is closed
+    bool remove(id t) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto i = tracks_.begin(); tracks_.end() != i; ++i) {
+            if (t == (*i)->key) {
+                closing_.push_back(*i);
+                tracks_.erase(i);
+                return true;
+            }
+        }
+        return false;
+    }
+public:
+    std::uint64_t frames() const {
+        return frames_.load(std::memory_order_relaxed);
+    }
+    std::uint64_t bytes() const {
+        return bytes_.load(std::memory_order_relaxed);
+    }
+    // frames the readers skipped because the disk did not keep up
+    std::uint64_t dropped() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+    std::uint64_t failures() const {
+        return failures_.load(std::memory_order_relaxed);
+    }
+private:
+    using reader = broadcast_ring<frame>::reader;
+
+    struct track final {
+        track(std::string const& n, reader&& r, bool video)
+            : name(file_name(n))
+            , frames(std::move(r))
+            , h264(video) {
+            // EMPTY
+        }
+        id key = 0;
+        std::string const name;
+        reader frames;
+        bool const h264;
+        // Annex-B SPS / PPS written at the head of every H.264 segment
+        std::string parameter_sets;
+        // the open segment
+        int data = -1;
+        int index = -1;
+        std::uint64_t data_size = 0;
+        std::uint64_t index_size = 0;
+        clock::time_point opened;
+        std::deque<std::string> segments;
+        // the batch
+        std::vector<frame> held;
+        std::vector<iovec> chunks;
+        std::vector<index_entry> entries;
+        std::size_t pending = 0;
+        clock::time_point flushed;
+        // seek points
+        clock::time_point indexed;
+        clock::time_point failed;
+        std::uint64_t skipped = 0;
+    };
+private:
+    id add(std::shared_ptr<track> const& t) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!working_) {
+            return 0;
+        }
+        t->key = ++next_;
+        tracks_.push_back(t);
+        return t->key;
+    }
+    void thread_routine() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;!cv_.wait_for(lock, tick, [this]() { return !working_; });) {
+            auto const tracks = tracks_;
+            auto closing = std::move(closing_);
+            closing_.clear();
+            lock.unlock();
+            auto const now = clock::now();
+            for (auto const& t : tracks) {
+                drain(*t, now);
+            }
+            for (auto const& t : closing) {
+                drain(*t, now);
+                close(*t);
+            }
+            lock.lock();
+        }
+    }
+private:
+    void drain(track& t, clock::time_point now) {
+        frame f;
+        bool key = false;
+        for (;t.frames.read(f, key);) {
+            append(t, f, key);
+        }
+        auto const skipped = t.frames.skipped();
+        dropped_.fetch_add(skipped - t.skipped, std::memory_order_relaxed);
+        t.skipped = skipped;
+        if (0 != t.pending && now - t.flushed >= flush_period) {
+            flush(t);
+        }
+    }
+    void append(track& t, frame const& f, bool key) {
+        if (f.empty()) {
+            return;
+        }
+        if (!seek_point(t, f, key)) {
+            return;
+        }
+        if (t.h264) {
+            push(t, start_code, sizeof(start_code));
+        }
+        push(t, f.data(), f.size());
+        t.held.push_back(f);
+        frames_.fetch_add(1, std::memory_order_relaxed);
+        if (t.pending >= write_size || t.chunks.size() + 2 > max_chunks) {
+            flush(t);
+        }
+    }
+    // Rolls the segment and notes a seek point when f is one, false when f
+    // cannot be written: H.264 waits for a keyframe after a failure. For
+    // H.264 key is the pump's, set on the first NAL of an access unit with
+    // an SPS or IDR; every ADTS packet is a key, one a second is indexed.
+    bool seek_point(track& t, frame const& f, bool key) {
+        if (!t.h264) {
+            key = t.data < 0 || f.ingest() - t.indexed >= aac_index_period;
+        }
+        if (!key) {
+            return t.data >= 0;
+        }
+        if (t.data < 0 && f.ingest() - t.failed < retry_period) {
+            return false;
+        }
+        auto const rolled = t.data < 0 || f.ingest() - t.opened >= segment_;
+        if (rolled && !roll(t, f)) {
+            return false;
+        }
+        // a seek to the head of a segment gets the parameter sets too
+        t.indexed = f.ingest();
+        t.entries.push_back({f.pts(), unix_us(f.ingest()), t.data_size});
+        if (rolled && !t.parameter_sets.empty()) {
+            push(t, t.parameter_sets.data(), t.parameter_sets.size());
+        }
+        return true;
+    }
+    void push(track& t, void const* bytes, std::size_t size) {
+        t.chunks.push_back({const_cast<void*>(bytes), size});
+        t.pending += size;
+        t.data_size += size;
+    }
+private:
+    bool roll(track& t, frame const& f) {
+        close(t);
+        auto const base = dir_ + "/" + t.name + "-" + stamp(f.ingest());
+        auto const data = base + extension(t);
+        auto const index = data + ".idx";
+        t.data = open(data);
+        t.index = open(index);
+        if (t.data < 0 || t.index < 0) {
+            std::cerr << "recorder: cannot create " << base << ": "
+                      << std::strerror(errno) << std::endl;
+            failures_.fetch_add(1, std::memory_order_relaxed);
+            close(t);
+            t.failed = f.ingest();
+            return false;
+        }
+        t.data_size = 0;
+        t.index_size = 0;
+        t.opened = f.ingest();
+        t.flushed = clock::now();
+        t.segments.push_back(base);
+        prune(t);
+        return true;
+    }
+    void prune(track& t) {
+        for (;0 != keep_ && t.segments.size() > keep_;) {
+            std::error_code ec;
+            auto const data = t.segments.front() + extension(t);
+            std::filesystem::remove(data, ec);
+            std::filesystem::remove(data + ".idx", ec);
+            t.segments.pop_front();
+        }
+    }
+    void close(track& t) {
+        flush(t);
+        if (t.data >= 0) {
+            ::close(t.data);
+            t.data = -1;
+        }
+        if (t.index >= 0) {
+            ::close(t.index);
+            t.index = -1;
+        }
+    }
+    // one pwritev for the frames, one pwrite for their seek points
+    void flush(track& t) {
+        auto ok = true;
+        if (!t.chunks.empty() && t.data >= 0) {
+            auto const offset = t.data_size - t.pending;
+            ok = write_at(t.data, t.chunks.data(), t.chunks.size(), offset);
+            if (ok) {
+                bytes_.fetch_add(t.pending, std::memory_order_relaxed);
+            }
+        }
+        if (ok && !t.entries.empty() && t.index >= 0) {
+            iovec chunk{ t.entries.data()
+                       , t.entries.size() * sizeof(index_entry)};
+            ok = write_at(t.index, &chunk, 1, t.index_size);
+            t.index_size += chunk.iov_len;
+        }
+        t.held.clear();
+        t.chunks.clear();
+        t.entries.clear();
+        t.pending = 0;
+        t.flushed = clock::now();
+        if (!ok) {
+            std::cerr << "recorder: " << t.name << ": write failed: "
+                      << std::strerror(errno) << std::endl;
+            failures_.fetch_add(1, std::memory_order_relaxed);
+            close(t);
+        }
+    }
+private:
+    static bool write_at( int fd
+                        , iovec* chunks
+                        , std::size_t n
+                        , std::uint64_t offset) {
+        for (;0 != n;) {
+            auto const count = static_cast<int>(n > max_chunks ? max_chunks
+                                                               : n);
+            auto w = ::pwritev(fd, chunks, count, static_cast<off_t>(offset));
+            if (w < 0) {
+                if (EINTR == errno) {
+                    continue;
+                }
+                return false;
+            }
+            offset += static_cast<std::uint64_t>(w);
+            // skip what went out, a short write resumes mid-chunk
+            auto left = static_cast<std::size_t>(w);
+            for (;0 != n && left >= chunks->iov_len; ++chunks, --n) {
+                left -= chunks->iov_len;
+            }
+            if (0 != n) {
+                chunks->iov_base = static_cast<char*>(chunks->iov_base) + left;
+                chunks->iov_len -= left;
+            }
+        }
+        return true;
+    }
+    static int open(std::string const& path) {
+        return ::open( path.c_str()
+                     , O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC
+                     , 0644);
+    }
+    static char const* extension(track const& t) {
+        return t.h264 ? ".h264" : ".aac";
+    }
+    static std::string file_name(std::string name) {
+        for (auto& c : name) {
+            c = ('/' == c || '\\' == c) ? '_' : c;
+        }
+        return name;
+    }
+    // ingest is on the steady clock, the files want wall clock time
+    static std::int64_t unix_us(clock::time_point t) {
+        auto const wall = std::chrono::system_clock::now()
+                        - std::chrono::duration_cast
+                          <std::chrono::system_clock::duration>
+                                (clock::now() - t);
+        return std::chrono::duration_cast<std::chrono::microseconds>
+                        (wall.time_since_epoch()).count();
+    }
+    // 20261018-093000, UTC
+    static std::string stamp(clock::time_point t) {
+        auto const s = static_cast<std::time_t>(unix_us(t) / 1000000);
+        std::tm tm{};
+        gmtime_r(&s, &tm);
+        std::ostringstream os;
+        os << std::put_time(&tm, "%Y%m%d-%H%M%S");
+        return os.str();
+    }
+private:
+    static auto constexpr tick = std::chrono::milliseconds{50};
+    static auto constexpr flush_period = std::chrono::seconds{1};
+    static auto constexpr aac_index_period = std::chrono::seconds{1};
+    // after a segment could not be created
+    static auto constexpr retry_period = std::chrono::seconds{1};
+    static auto constexpr write_size = std::size_t{1} << 20;
+    static auto constexpr max_chunks = std::size_t{1024};
+    static constexpr char start_code[4] = {0, 0, 0, 1};
+private:
+    std::string const dir_;
+    std::chrono::seconds const segment_;
+    std::size_t const keep_;
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool working_ = false;
+    std::thread thread_;
+    std::vector<std::shared_ptr<track>> tracks_;
+    std::vector<std::shared_ptr<track>> closing_;
+    id next_ = 0;
+private:
+    std::atomic<std::uint64_t> frames_{0};
+    std::atomic<std::uint64_t> bytes_{0};
+    std::atomic<std::uint64_t> dropped_{0};
+    std::atomic<std::uint64_t> failures_{0};
+};
+
+
+#endif // RECORDER_HXX
@@ -0,0 +1,82 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef SHARD_SERVER_HXX
+#define SHARD_SERVER_HXX
+
+
+#include <string>
+#include <GroupsockHelper.hh>
+#include <RTSPServer.hh>
+
+
+//
+// - RTSPServer for one event loop of a stream_server
+//    - It listens on a throwaway ephemeral port; its clients are accepted on
+//      the public port and handed over through adopt().
+//    - URLs it builds carry the public port.
+//
+class shard_server final: public RTSPServer {
+public:
+    static shard_server* createNew( UsageEnvironment& env
+                                  , std::uint16_t public_port) {
+        Port port{0};
+        auto const socket = setUpOurSocket(env, port);
+        if (socket < 0) {
+            return nullptr;
+        }
+        return new shard_server(env, socket, public_port);
+    }
+    // the public listening socket, set up the way live555 sets up its own
+    static int listen(UsageEnvironment& env, std::uint16_t public_port) {
+        Port port{public_port};
+        return setUpOurSocket(env, port);
+    }
+    // stream name of the first request line, "rtsp://host:port/name/track1"
+    // and "GET /name HTTP/1.0" both yield "name/track1" and "name"
+    static std::string stream_name(std::string const& request_line) {
+        auto const begin = request_line.find(' ');
+        if (std::string::npos == begin) {
+            return std::string{};
+        }
+        auto const end = request_line.find(' ', begin + 1);
+        auto url = request_line.substr(begin + 1, end - begin - 1);
+        auto const scheme = url.find("://");
+        if (std::string::npos != scheme) {
+            auto const path = url.find('/', scheme + 3);
+            url = (std::string::npos == path) ? std::string{}
+                                              : url.substr(path);
+        }
+        auto const query = url.find('?');
+        if (std::string::npos != query) {
+            url.resize(query);
+        }
+        auto const first = url.find_first_not_of('/');
+        if (std::string::npos == first) {
+            return std::string{};
+        }
+        auto const last = url.find_last_not_of('/');
+        return url.substr(first, last - first + 1);
+    }
+private:
+    shard_server( UsageEnvironment& env
+                , int socket
+                , std::uint16_t public_port)
+        : RTSPServer(env, socket, Port{public_port}, nullptr, 65) {
+        // EMPTY
+    }
+public:
+    virtual ~shard_server() = default;
+public:
+    // takes over a connection accepted elsewhere, on this server's loop
+    void adopt(int socket, struct sockaddr_in const& addr) {
+        createNewClientConnection(socket, addr);
+    }
+};
+
+
+#endif // SHARD_SERVER_HXX
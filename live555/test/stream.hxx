@@ -10,6 +10,7 @@
 
 
 #include <atomic>
+#include <chrono>
 #include <mutex>
 #include <memory>
 #include <string>
@@ -21,6 +22,11 @@
 #include "./aac_subsession.hxx"
 #include "./h264_pump.hxx"
 #include "./h264_subsession.hxx"
+#include "./histogram.hxx"
+#include "./metrics.hxx"
+#include "./multicast_output.hxx"
+#include "./recorder.hxx"
+#include "./timeline.hxx"
 
 #define STREAM_TEST 1
 #if !defined(_DEBUG) && !defined(DEBUG)
@@ -38,13 +44,13 @@ private:
     using ulock = std::unique_lock<std::mutex>;
 public:
     stream(std::string const& path, std::uint16_t port)
-        : env_(create_env()) {
+        : env_(create_env())
+        , path_(path) {
         server_ = RTSPServer::createNew(*env_, port);
         if (nullptr == server_) {
             return;
         }
-        session_ = ServerMediaSession::createNew(*env_, path.c_str());
-        url_ = url(server_, session_);
+        url_ = url(server_, path_);
         available_ = true;
     }
     ~stream() {
@@ -60,6 +66,20 @@ public:
         return url_;
     }
 public:
+    // Every start() after this also writes its pumps to rolling segments
+    // under dir, see recorder, until end(); an empty dir stops that.
+    void record( std::string const& dir
+               , std::chrono::seconds segment = std::chrono::seconds{60}
+               , std::size_t keep = 0) {
+        record_dir_ = dir;
+        record_segment_ = segment;
+        record_keep_ = keep;
+    }
+public:
+    // h264_pacing_us spaces the packets of an access unit out, a burst of
+    // them at a time that far apart, see batch_groupsock; unicast only.
+    // aac_max_frames above one packs that many AAC frames per packet,
+    // waiting at most aac_max_ms for them, see aac_source
     bool start( std::uint8_t aac_profile
               , std::uint8_t aac_sampling_frequency_index
               , std::uint8_t aac_channel_config
@@ -67,43 +87,79 @@ public:
               , unsigned h264_height
               , unsigned h264_bitrate
 #if STREAM_TEST
-              , unsigned h264_fps) {
+              , unsigned h264_fps
 #else
               , unsigned h264_fps
               , std::string const& h264_sps
-              , std::string const& h264_pps) {
+              , std::string const& h264_pps
 #endif
+              , multicast_group const& multicast = multicast_group{}
+              , unsigned h264_pacing_us = 0
+              , unsigned aac_max_frames = 1
+              , unsigned aac_max_ms = 0) {
         if (working_) {
             end();
         }
         working_ = true;
+        // audio and video PTS are on one clock, so they share the mapping
+        auto const pts_timeline = std::make_shared<timeline>();
         aac_pump_.reset(new aac_pump{ aac_utils::sampling_frequency
                                     ( aac_sampling_frequency_index)
-                                    , buffer_ms});
-        h264_pump_.reset(new h264_pump{h264_fps, buffer_ms});
+                                    , buffer_ms
+                                    , pts_timeline});
+        h264_pump_.reset(new h264_pump{h264_fps, buffer_ms, pts_timeline});
+        metrics_ = metrics::shared().add(path_
+                                        , metrics::of(aac_pump_, h264_pump_));
 #if STREAM_TEST
-        aac_producer_.reset(new aac_producer(aac_pump_));
-        h264_producer_.reset(new h264_producer(h264_pump_));
+        // one start for both, so audio and video leave in step
+        auto const start = pacer::clock::now();
+        aac_producer_.reset(new aac_producer(aac_pump_, "test.aac", start));
+        h264_producer_.reset(new h264_producer( h264_pump_
+                                              , "test.h264"
+                                              , h264_fps
+                                              , start));
         auto const h264_sps = h264_producer_->sps();
         auto const h264_pps = h264_producer_->pps();
 #endif
+        if (!record_dir_.empty()) {
+            recorder_.reset(new recorder{ record_dir_
+                                        , record_segment_
+                                        , record_keep_});
+            recorder_->add(path_, h264_pump_, h264_sps, h264_pps);
+            recorder_->add(path_, aac_pump_);
+        }
+        if (multicast) {
+            return start_multicast( multicast
+                                  , aac_profile
+                                  , aac_sampling_frequency_index
+                                  , aac_channel_config
+                                  , h264_fps
+                                  , h264_sps
+                                  , h264_pps
+                                  , aac_max_frames
+                                  , aac_max_ms);
+        }
+        session_ = ServerMediaSession::createNew(*env_, path_.c_str());
         auto const aac_ss = new aac_subsession( *env_
                                               , true
                                               , aac_pump_
                                               , aac_profile
                                               , aac_sampling_frequency_index
-                                              , aac_channel_config);
+                                              , aac_channel_config
+                                              , aac_max_frames
+                                              , aac_max_ms);
         if (!session_->addSubsession(aac_ss)) {
-            return false;
+            return abandon();
         }
         auto const h264_ss = new h264_subsession( *env_
                                                 , true
                                                 , h264_pump_
                                                 , h264_fps
                                                 , h264_sps
-                                                , h264_pps);
+                                                , h264_pps
+                                                , h264_pacing_us);
         if (!session_->addSubsession(h264_ss)) {
-            return false;
+            return abandon();
         }
         server_->addServerMediaSession(session_);
         return loop();
@@ -113,31 +169,120 @@ public:
             return false;
         }
         working_ = false;
+        metrics::shared().remove(metrics_);
         event_looping_ = 1;
         ulock lock(finish_mutex_);
         auto const wait_predicate = [this]() -> bool {
             return finished_;
         };
         finish_cv_.wait(lock, wait_predicate);
+        // a session is never reused, the next start() makes its own
         server_->deleteServerMediaSession(session_);
+        session_ = nullptr;
+        multicast_.reset();
+        // writes what it gathered and closes the segments
+        recorder_.reset();
         return true;
     }
 
 public:
     bool push_aac(std::string const& packet) {
-        return h264_pump_->produce(packet);
+        return aac_pump_->produce(packet);
+    }
+    bool push_aac(frame const& packet) {
+        return aac_pump_->produce(packet);
+    }
+    bool push_h264(std::string const& bytes) {
+        return h264_pump_->produce(bytes);
+    }
+    bool push_h264(frame const& f) {
+        return h264_pump_->produce(f);
+    }
+    // pts in microseconds on the capture clock, ingest when it was captured
+    bool push_aac( std::string const& packet
+                 , std::int64_t pts
+                 , frame::clock::time_point ingest = frame::clock::now()) {
+        return push_aac(frame::copy(packet), pts, ingest);
+    }
+    bool push_aac( frame const& packet
+                 , std::int64_t pts
+                 , frame::clock::time_point ingest = frame::clock::now()) {
+        auto f = packet;
+        return aac_pump_->produce(f.pts(pts).ingest(ingest));
     }
-    bool push_h264(std::string const& frame) {
-        return h264_pump_->produce(frame);
+    bool push_h264( std::string const& bytes
+                  , std::int64_t pts
+                  , frame::clock::time_point ingest = frame::clock::now()) {
+        return push_h264(frame::copy(bytes), pts, ingest);
+    }
+    bool push_h264( frame const& au
+                  , std::int64_t pts
+                  , frame::clock::time_point ingest = frame::clock::now()) {
+        auto f = au;
+        return h264_pump_->produce(f.pts(pts).ingest(ingest));
+    }
+public:
+    // ingest to RTP hand-off, microseconds
+    histogram& aac_latency() {
+        return aac_pump_->latency();
+    }
+    histogram& h264_latency() {
+        return h264_pump_->latency();
     }
 private:
     static inline BasicUsageEnvironment* create_env() {
         auto const scheduler = BasicTaskScheduler::createNew();
         return BasicUsageEnvironment::createNew(*scheduler);
     }
-    static std::string url(RTSPServer* server, ServerMediaSession* session) {
-        std::unique_ptr<char[]> url{server->rtspURL(session)};
-        return std::string{url.get()};
+    // what rtspURL() gives for a session named path, before there is one
+    static std::string url(RTSPServer* server, std::string const& path) {
+        std::unique_ptr<char[]> prefix{server->rtspURLPrefix()};
+        return std::string{prefix.get()} + path;
+    }
+private:
+    // One sink pair sends to the group for every viewer; SETUP hands the
+    // group out, which takes an SSM session.
+    bool start_multicast( multicast_group const& group
+                        , std::uint8_t aac_profile
+                        , std::uint8_t aac_sampling_frequency_index
+                        , std::uint8_t aac_channel_config
+                        , unsigned h264_fps
+                        , std::string const& h264_sps
+                        , std::string const& h264_pps
+                        , unsigned aac_max_frames
+                        , unsigned aac_max_ms) {
+        session_ = ServerMediaSession::createNew( *env_
+                                                , path_.c_str()
+                                                , nullptr
+                                                , nullptr
+                                                , True);
+        multicast_.reset(new multicast_output{*env_, group});
+        if (!multicast_->add_aac( session_
+                                , aac_pump_
+                                , aac_profile
+                                , aac_sampling_frequency_index
+                                , aac_channel_config
+                                , aac_max_frames
+                                , aac_max_ms)
+            || !multicast_->add_h264( session_
+                                    , h264_pump_
+                                    , h264_fps
+                                    , h264_sps
+                                    , h264_pps)) {
+            return abandon();
+        }
+        server_->addServerMediaSession(session_);
+        return loop();
+    }
+    // a start() that failed before its loop ran, end() has nothing to stop
+    bool abandon() {
+        Medium::close(session_);
+        session_ = nullptr;
+        multicast_.reset();
+        recorder_.reset();
+        metrics::shared().remove(metrics_);
+        working_ = false;
+        return false;
     }
 private:
     void thread_routine() {
@@ -146,6 +291,9 @@ private:
         std::notify_all_at_thread_exit(finish_cv_, ulock{finish_mutex_});
     }
     bool loop() {
+        // left set by the loop of a previous start()
+        event_looping_ = 0;
+        finished_ = false;
         thread_ = std::thread{&stream::thread_routine, this};
         try {
             thread_.detach();
@@ -165,12 +313,19 @@ private:
     std::atomic_bool working_{false};
 private:
     BasicUsageEnvironment* env_;
-    ServerMediaSession* session_;
+    ServerMediaSession* session_ = nullptr;
     RTSPServer* server_;
     std::string url_;
+    std::string path_;
+    metrics::id metrics_ = 0;
 private:
     std::shared_ptr<aac_pump> aac_pump_;
     std::shared_ptr<h264_pump> h264_pump_;
+    std::unique_ptr<multicast_output> multicast_;
+    std::unique_ptr<recorder> recorder_;
+    std::string record_dir_;
+    std::chrono::seconds record_segment_{60};
+    std::size_t record_keep_ = 0;
 #if STREAM_TEST
     std::shared_ptr<aac_producer> aac_producer_;
     std::shared_ptr<h264_producer> h264_producer_;
@@ -0,0 +1,496 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef STREAM_SERVER_HXX
+#define STREAM_SERVER_HXX
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <GroupsockHelper.hh>
+#include "./aac_pump.hxx"
+#include "./aac_subsession.hxx"
+#include "./event_loop.hxx"
+#include "./h264_pump.hxx"
+#include "./h264_subsession.hxx"
+#include "./histogram.hxx"
+#include "./metrics.hxx"
+#include "./shard_server.hxx"
+#include "./timeline.hxx"
+
+
+//
+// - Many channels behind one RTSP port, spread over a fixed set of loops
+//    - Every loop (one per core by default) runs its own shard_server; a
+//      channel lives on the loop carrying the fewest channels.
+//    - The first loop also owns the public port. It peeks at the first
+//      request line of every new connection and hands the socket to the loop
+//      serving the requested stream. Requests naming no known stream stay on
+//      the first loop, which answers them like any RTSPServer would. A
+//      connection that has not sent its request line within 10 s is closed.
+//    - add() and remove() may be called from any thread at any time.
+//
+class stream_server final {
+public:
+    class channel final {
+    private:
+        friend class stream_server;
+        channel( std::string const& name
+               , std::size_t shard
+               , std::shared_ptr<aac_pump> const& aac
+               , std::shared_ptr<h264_pump> const& h264
+               , std::string const& sps
+               , std::string const& pps)
+            : name_(name)
+            , shard_(shard)
+            , sps_(sps)
+            , pps_(pps)
+            , aac_pump_(aac)
+            , h264_pump_(h264) {
+            // EMPTY
+        }
+    public:
+        ~channel() = default;
+    public:
+        std::string const& name() const {
+            return name_;
+        }
+        std::string const& url() const {
+            return url_;
+        }
+    public:
+        bool push_aac(std::string const& packet) {
+            return aac_pump_->produce(packet);
+        }
+        bool push_aac(frame const& packet) {
+            return aac_pump_->produce(packet);
+        }
+        bool push_h264(std::string const& bytes) {
+            return h264_pump_->produce(bytes);
+        }
+        bool push_h264(frame const& f) {
+            return h264_pump_->produce(f);
+        }
+        // pts in microseconds on the capture clock
+        bool push_aac( frame const& packet
+                     , std::int64_t pts
+                     , frame::clock::time_point ingest = frame::clock::now()) {
+            auto f = packet;
+            return aac_pump_->produce(f.pts(pts).ingest(ingest));
+        }
+        bool push_h264( frame const& au
+                      , std::int64_t pts
+                      , frame::clock::time_point ingest = frame::clock::now()) {
+            auto f = au;
+            return h264_pump_->produce(f.pts(pts).ingest(ingest));
+        }
+    public:
+        // the pumps, for taps such as a recorder
+        std::shared_ptr<aac_pump> const& aac() const {
+            return aac_pump_;
+        }
+        std::shared_ptr<h264_pump> const& h264() const {
+            return h264_pump_;
+        }
+        // the parameter sets announced to clients, raw NALs
+        std::string const& sps() const {
+            return sps_;
+        }
+        std::string const& pps() const {
+            return pps_;
+        }
+    public:
+        // ingest to RTP hand-off, microseconds
+        histogram& aac_latency() {
+            return aac_pump_->latency();
+        }
+        histogram& h264_latency() {
+            return h264_pump_->latency();
+        }
+    private:
+        std::string const name_;
+        std::size_t const shard_;
+        std::string const sps_;
+        std::string const pps_;
+        std::string url_;
+        ServerMediaSession* session_ = nullptr;
+        metrics::id metrics_ = 0;
+    private:
+        std::shared_ptr<aac_pump> aac_pump_;
+        std::shared_ptr<h264_pump> h264_pump_;
+    };
+public:
+    // threads == 0 picks one loop per core
+    explicit stream_server( std::uint16_t port
+                          , unsigned threads = 0
+                          , bool pinned = false)
+        : port_(port) {
+        if (0 == threads) {
+            threads = std::thread::hardware_concurrency();
+        }
+        if (0 == threads) {
+            threads = 1;
+        }
+        auto const cores = std::thread::hardware_concurrency();
+        for (unsigned i = 0; i < threads; ++i) {
+            auto const cpu = (pinned && 0 != cores)
+                           ? static_cast<int>(i % cores)
+                           : -1;
+            shards_.emplace_back(new shard{cpu});
+        }
+        available_ = start();
+    }
+    ~stream_server() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto const& c : channels_) {
+                metrics::shared().remove(c.second->metrics_);
+            }
+        }
+        shards_.front()->loop.call([this]() {
+            stop_accepting();
+        });
+        for (auto& s : shards_) {
+            s->loop.call([&s]() {
+                Medium::close(s->server);
+                s->server = nullptr;
+            });
+        }
+        for (auto& s : shards_) {
+            s->loop.stop();
+        }
+    }
+    stream_server(stream_server const&) = delete;
+    stream_server& operator=(stream_server const&) = delete;
+public:
+    bool available() const {
+        return available_;
+    }
+    std::size_t threads() const {
+        return shards_.size();
+    }
+    std::size_t channels() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return channels_.size();
+    }
+    std::shared_ptr<channel> find(std::string const& name) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto const i = channels_.find(name);
+        return channels_.end() == i ? nullptr : i->second;
+    }
+public:
+    std::shared_ptr<channel> add( std::string const& name
+                                , std::uint8_t aac_profile
+                                , std::uint8_t aac_sampling_frequency_index
+                                , std::uint8_t aac_channel_config
+                                , unsigned h264_fps
+                                , std::string const& h264_sps
+                                , std::string const& h264_pps
+                                , unsigned h264_pacing_us = 0
+                                , unsigned aac_max_frames = 1
+                                , unsigned aac_max_ms = 0) {
+        if (!available_ || name.empty()) {
+            return nullptr;
+        }
+        std::shared_ptr<channel> c;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (channels_.end() != channels_.find(name)) {
+                std::cerr << "channel exists: " << name << std::endl;
+                return nullptr;
+            }
+            auto const i = least_loaded();
+            auto const pts_timeline = std::make_shared<timeline>();
+            auto const aac = std::make_shared<aac_pump>
+                           ( aac_utils::sampling_frequency
+                             (aac_sampling_frequency_index)
+                           , buffer_ms
+                           , pts_timeline);
+            auto const h264 = std::make_shared<h264_pump>( h264_fps
+                                                         , buffer_ms
+                                                         , pts_timeline);
+            c.reset(new channel{name, i, aac, h264, h264_sps, h264_pps});
+            ++shards_[i]->channels;
+            channels_[name] = c;
+        }
+        auto& s = *shards_[c->shard_];
+        auto ok = false;
+        s.loop.call([&]() {
+            auto& env = s.loop.env();
+            auto const session = ServerMediaSession::createNew( env
+                                                              , name.c_str());
+            auto const aac_ss = new aac_subsession( env
+                                                  , true
+                                                  , c->aac_pump_
+                                                  , aac_profile
+                                                  , aac_sampling_frequency_index
+                                                  , aac_channel_config
+                                                  , aac_max_frames
+                                                  , aac_max_ms);
+            auto const h264_ss = new h264_subsession( env
+                                                    , true
+                                                    , c->h264_pump_
+                                                    , h264_fps
+                                                    , h264_sps
+                                                    , h264_pps
+                                                    , h264_pacing_us);
+            if (!session->addSubsession(aac_ss)
+                || !session->addSubsession(h264_ss)) {
+                Medium::close(session);
+                return;
+            }
+            s.server->addServerMediaSession(session);
+            std::unique_ptr<char[]> url{s.server->rtspURL(session)};
+            c->url_ = url.get();
+            c->session_ = session;
+            ok = true;
+        });
+        if (!ok) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --s.channels;
+            channels_.erase(name);
+            return nullptr;
+        }
+        c->metrics_ = metrics::shared().add( name
+                                           , metrics::of( c->aac_pump_
+                                                        , c->h264_pump_));
+        return c;
+    }
+    // closes every client session of the channel
+    bool remove(std::string const& name) {
+        std::shared_ptr<channel> c;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto const i = channels_.find(name);
+            if (channels_.end() == i) {
+                return false;
+            }
+            c = i->second;
+            channels_.erase(i);
+            --shards_[c->shard_]->channels;
+        }
+        metrics::shared().remove(c->metrics_);
+        auto& s = *shards_[c->shard_];
+        s.loop.call([&]() {
+            s.server->deleteServerMediaSession(c->session_);
+            c->session_ = nullptr;
+        });
+        return true;
+    }
+private:
+    struct shard {
+        explicit shard(int cpu)
+            : loop(cpu) {
+            // EMPTY
+        }
+        event_loop loop;
+        shard_server* server = nullptr;
+        std::size_t channels = 0;
+    };
+    struct pending {
+        stream_server* server;
+        int socket;
+        struct sockaddr_in addr;
+        TaskToken retry;
+        TaskToken expiry;
+    };
+private:
+    bool start() {
+        auto ok = true;
+        for (auto& s : shards_) {
+            s->loop.call([this, &s, &ok]() {
+                s->server = shard_server::createNew(s->loop.env(), port_);
+                if (nullptr == s->server) {
+                    ok = false;
+                }
+            });
+        }
+        if (!ok) {
+            std::cerr << "shard server failed" << std::endl;
+            return false;
+        }
+        shards_.front()->loop.call([this, &ok]() {
+            ok = start_accepting();
+        });
+        return ok;
+    }
+    // the following run on the first loop
+    bool start_accepting() {
+        auto& env = shards_.front()->loop.env();
+        socket_ = shard_server::listen(env, port_);
+        if (socket_ < 0) {
+            std::cerr << "listen failed: " << port_ << std::endl;
+            return false;
+        }
+        env.taskScheduler().turnOnBackgroundReadHandling( socket_
+                                                        , &on_accept
+                                                        , this);
+        return true;
+    }
+    void stop_accepting() {
+        if (socket_ < 0) {
+            return;
+        }
+        auto& scheduler = shards_.front()->loop.env().taskScheduler();
+        scheduler.turnOffBackgroundReadHandling(socket_);
+        closeSocket(socket_);
+        socket_ = -1;
+        for (;!pending_.empty();) {
+            auto const socket = pending_.begin()->first;
+            forget(socket);
+            closeSocket(socket);
+        }
+    }
+    static void on_accept(void* self, int) {
+        static_cast<stream_server*>(self)->accept();
+    }
+    static void on_request(void* client, int) {
+        auto const p = static_cast<pending*>(client);
+        p->server->route(p->socket);
+    }
+    static void on_retry(void* client) {
+        auto const p = static_cast<pending*>(client);
+        p->retry = nullptr;
+        p->server->route(p->socket);
+    }
+    static void on_expiry(void* client) {
+        auto const p = static_cast<pending*>(client);
+        p->expiry = nullptr;
+        p->server->drop(p->socket);
+    }
+    void accept() {
+        auto& env = shards_.front()->loop.env();
+        struct sockaddr_in addr;
+        SOCKLEN_T len = sizeof(addr);
+        auto const socket = ::accept( socket_
+                                    , reinterpret_cast<struct sockaddr*>(&addr)
+                                    , &len);
+        if (socket < 0) {
+            return;
+        }
+        makeSocketNonBlocking(socket);
+        increaseSendBufferTo(env, socket, 50 * 1024);
+        auto& p = pending_[socket];
+        p.reset(new pending{this, socket, addr, nullptr, nullptr});
+        auto& scheduler = env.taskScheduler();
+        scheduler.turnOnBackgroundReadHandling(socket, &on_request, p.get());
+        // a client that never completes its request line goes away
+        p->expiry = scheduler.scheduleDelayedTask( request_timeout_us
+                                                 , &on_expiry
+                                                 , p.get());
+    }
+    void route(int socket) {
+        auto const i = pending_.find(socket);
+        if (pending_.end() == i) {
+            return;
+        }
+        char bytes[peek_size];
+        auto const n = ::recv(socket, bytes, sizeof(bytes), MSG_PEEK);
+        if (n <= 0) {
+            auto const& env = shards_.front()->loop.env();
+            if (0 == n || EWOULDBLOCK != env.getErrno()) {
+                drop(socket);
+            }
+            return;
+        }
+        auto const size = static_cast<std::size_t>(n);
+        auto const eol = std::find(bytes, bytes + size, '\n');
+        if (bytes + size == eol && size < sizeof(bytes)) {
+            // The request line is still on its way. Peeked bytes stay queued
+            // and read handling is level-triggered, so instead of being woken
+            // for them again and again, look once more a little later.
+            auto& p = *i->second;
+            if (nullptr == p.retry) {
+                auto& scheduler = shards_.front()->loop.env().taskScheduler();
+                scheduler.turnOffBackgroundReadHandling(socket);
+                p.retry = scheduler.scheduleDelayedTask( retry_us
+                                                       , &on_retry
+                                                       , &p);
+            }
+            return;
+        }
+        auto const line = std::string{bytes, eol};
+        auto const addr = i->second->addr;
+        forget(socket);
+        auto& s = *shards_[owner(shard_server::stream_name(line))];
+        if (s.loop.in_loop()) {
+            s.server->adopt(socket, addr);
+            return;
+        }
+        auto const server = s.server;
+        s.loop.post([server, socket, addr]() {
+            server->adopt(socket, addr);
+        });
+    }
+    void drop(int socket) {
+        forget(socket);
+        closeSocket(socket);
+    }
+    // stops watching a pending socket, leaves it open
+    void forget(int socket) {
+        auto const i = pending_.find(socket);
+        if (pending_.end() == i) {
+            return;
+        }
+        auto& scheduler = shards_.front()->loop.env().taskScheduler();
+        scheduler.turnOffBackgroundReadHandling(socket);
+        scheduler.unscheduleDelayedTask(i->second->retry);
+        scheduler.unscheduleDelayedTask(i->second->expiry);
+        pending_.erase(i);
+    }
+    // "name/track1" belongs to the channel "name"
+    std::size_t owner(std::string name) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (;!name.empty();) {
+            auto const i = channels_.find(name);
+            if (channels_.end() != i) {
+                return i->second->shard_;
+            }
+            auto const slash = name.rfind('/');
+            if (std::string::npos == slash) {
+                break;
+            }
+            name.resize(slash);
+        }
+        return 0;
+    }
+    std::size_t least_loaded() const {
+        std::size_t best = 0;
+        for (std::size_t i = 1; i < shards_.size(); ++i) {
+            if (shards_[i]->channels < shards_[best]->channels) {
+                best = i;
+            }
+        }
+        return best;
+    }
+private:
+    static auto const buffer_ms = 500u;
+    static auto const peek_size = 1024u;
+    static auto const retry_us = 10000u;
+    static auto const request_timeout_us = 10000000u;
+private:
+    std::uint16_t const port_;
+    bool available_ = false;
+    std::vector<std::unique_ptr<shard>> shards_;
+private:
+    mutable std::mutex mutex_;
+    std::map<std::string, std::shared_ptr<channel>> channels_;
+private:
+    int socket_ = -1;
+    std::map<int, std::unique_ptr<pending>> pending_;
+};
+
+
+#endif // STREAM_SERVER_HXX
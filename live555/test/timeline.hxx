@@ -0,0 +1,81 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef TIMELINE_HXX
+#define TIMELINE_HXX
+
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#if defined(_WIN32)
+    // gettimeofday, live555 supplies it there
+#   include <GroupsockHelper.hh>
+#else
+#   include <sys/time.h>
+#endif
+
+
+//
+// - Maps pushed PTS onto the wall clock live555 turns into RTP time
+//    - The first PTS seen is pinned to the time of day its frame entered
+//      the server, every later one keeps its distance to it, so the RTP
+//      timestamps carry the capture cadence rather than the arrival cadence.
+//    - All sources of one stream share a timeline, their PTS being on the
+//      same clock this keeps audio and video in sync.
+//    - A PTS jumping further than max_skew_us away from the wall clock
+//      (a restarted encoder, a wrapped counter) pins the timeline again.
+//      Only a fresh frame may do that: one that entered more than max_age_us
+//      ago, a replayed cached IDR or a frame a late reader caught up with,
+//      is mapped as it is, or every other client would jump with it.
+//
+class timeline final {
+public:
+    using clock = std::chrono::steady_clock;
+public:
+    static auto constexpr max_skew_us = std::int64_t{5 * 1000000};
+    static auto constexpr max_age_us = std::int64_t{1000000};
+public:
+    timeline() = default;
+    ~timeline() = default;
+    timeline(timeline const&) = delete;
+    timeline& operator=(timeline const&) = delete;
+public:
+    // ingest is when the frame carrying pts entered the server
+    struct timeval map(std::int64_t pts, clock::time_point ingest) {
+        struct timeval now;
+        gettimeofday(&now, nullptr);
+        auto const age = std::chrono::duration_cast<std::chrono::microseconds>
+                                (clock::now() - ingest).count();
+        auto const entered_us = std::int64_t{now.tv_sec} * 1000000
+                              + now.tv_usec
+                              - (age > 0 ? age : 0);
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto at = base_us_ + (pts - pts_);
+        auto const skew = at > entered_us ? at - entered_us
+                                          : entered_us - at;
+        auto const fresh = age <= max_age_us;
+        if (!pinned_ || (fresh && skew > max_skew_us)) {
+            pinned_ = true;
+            pts_ = pts;
+            base_us_ = entered_us;
+            at = entered_us;
+        }
+        struct timeval tv;
+        tv.tv_sec = static_cast<decltype(tv.tv_sec)>(at / 1000000);
+        tv.tv_usec = static_cast<decltype(tv.tv_usec)>(at % 1000000);
+        return tv;
+    }
+private:
+    std::mutex mutex_;
+    bool pinned_ = false;
+    std::int64_t pts_ = 0;
+    std::int64_t base_us_ = 0;
+};
+
+
+#endif // TIMELINE_HXX
@@ -0,0 +1,115 @@
+//
+// @author trimnalt AT gmail DOT com
+// @version initial
+// @date 2026-10-18
+//
+
+
+#ifndef WAKEUP_HXX
+#define WAKEUP_HXX
+
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <UsageEnvironment.hh>
+
+
+//
+// - Cross-thread wakeups for one live555 event loop
+//    - A BasicTaskScheduler only has 32 event triggers, far fewer than the
+//      sources a loop may carry, so every loop gets exactly one trigger and
+//      the sources to wake are queued behind it.
+//    - post() may be called from any thread, the handlers run on the loop.
+//    - cancel() must be called on the loop before a posted client dies.
+//
+class wakeup final {
+public:
+    using handler = void (*)(void*);
+public:
+    static std::shared_ptr<wakeup> of(TaskScheduler& scheduler) {
+        static std::mutex mutex;
+        static std::map<TaskScheduler*, std::weak_ptr<wakeup>> registry;
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto i = registry.begin(); i != registry.end();) {
+            i = i->second.expired() ? registry.erase(i) : std::next(i);
+        }
+        auto& slot = registry[&scheduler];
+        auto w = slot.lock();
+        if (!w) {
+            w.reset(new wakeup{scheduler});
+            slot = w;
+        }
+        return w;
+    }
+public:
+    ~wakeup() {
+        scheduler_.deleteEventTrigger(trigger_);
+    }
+    wakeup(wakeup const&) = delete;
+    wakeup& operator=(wakeup const&) = delete;
+private:
+    explicit wakeup(TaskScheduler& scheduler)
+        : scheduler_(scheduler)
+        , trigger_(scheduler.createEventTrigger(&wakeup::on_event)) {
+        // EMPTY
+    }
+public:
+    void post(handler h, void* client) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_.emplace_back(h, client);
+        }
+        scheduler_.triggerEvent(trigger_, this);
+    }
+    void cancel(void* client) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& p : pending_) {
+            if (client == p.second) {
+                p.second = nullptr;
+            }
+        }
+        for (auto& p : draining_) {
+            if (client == p.second) {
+                p.second = nullptr;
+            }
+        }
+    }
+private:
+    static void on_event(void* self) {
+        static_cast<wakeup*>(self)->drain();
+    }
+    void drain() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            draining_.swap(pending_);
+        }
+        // handlers may cancel() entries still waiting in draining_
+        for (std::size_t i = 0; i < draining_.size(); ++i) {
+            handler h = nullptr;
+            void* client = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                h = draining_[i].first;
+                client = draining_[i].second;
+            }
+            if (nullptr != client) {
+                h(client);
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        draining_.clear();
+    }
+private:
+    TaskScheduler& scheduler_;
+    EventTriggerId trigger_;
+private:
+    std::mutex mutex_;
+    std::vector<std::pair<handler, void*>> pending_;
+    std::vector<std::pair<handler, void*>> draining_;
+};
+
+
+#endif // WAKEUP_HXX